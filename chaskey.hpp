@@ -27,6 +27,12 @@
 #pragma once
 #include <stdint.h>
 #include <byteswap.h>
+#ifdef __AVX512F__
+#include <immintrin.h>
+#endif
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
 
 namespace crypto {
 
@@ -36,7 +42,23 @@ namespace crypto {
  * crypto::chaskye::Cipher8::Mac
  * crypto::chaskye::Cipher8::Cbc
  * crypto::chaskye::Cipher8::Cloc
+ * crypto::chaskye::Cipher8::Ctr
+ * crypto::chaskye::Cipher8::Pmac
+ * crypto::chaskye::Cipher8::Eax
+ * crypto::chaskye::Cipher8::Xex
+ * crypto::chaskye::Cipher8::Tree
+ * crypto::chaskye::Cipher8::Etm
+ */
+
+/**
+ * iovec - a fragment of a message, mirrors POSIX struct iovec for targets
+ * without sys/uio.h. Scatter-gather overloads of the modes accept arrays
+ * of either of them
  */
+struct iovec {
+	const void* iov_base;
+	decltype(sizeof(0)) iov_len;
+};
 
 /**
  * BlockCipherPrototype - a template-skeleton for implementing block ciphers
@@ -44,6 +66,7 @@ namespace crypto {
  * Algorithm must implement
  * 1.  void permute(Block&);			- forward transform
  * 2.  void etumrep(Block&);			- reverse transform
+ * Batch transforms run one block at a time
  */
 
 template<typename BlockType, class Algorithm>
@@ -65,6 +88,14 @@ public:
 	static constexpr uint_fast8_t size() noexcept { return sizeof(data); }
 	inline void init(const block_t& block) noexcept { operator=(block);	}
 	static inline void derive(block_t&, const block_t&) noexcept {}
+	struct Batch {
+		static inline void permute(block_t* blocks, unsigned count) noexcept {
+			while( count-- ) Algorithm::permute(*blocks++);
+		}
+		static inline void etumrep(block_t* blocks, unsigned count) noexcept {
+			while( count-- ) Algorithm::etumrep(*blocks++);
+		}
+	};
 	static inline constexpr
 	BlockCipherPrototype& cast(Block& block) noexcept {
 		return static_cast<BlockCipherPrototype&>(block);
@@ -78,6 +109,51 @@ private:
 };
 
 namespace details {
+	struct arch_traits {
+		/* free standing constexpr not yet available,
+		 * therefore it has to be placed inside  a struct 						*/
+		static bool constexpr big_endian = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+#	ifdef __xtensa__
+		/* unaligned access to uint32_t causes system fault on esp8266			 */
+		static bool constexpr direct_safe = false;
+#	else
+		static bool constexpr direct_safe = ! big_endian;
+#	endif
+		/* true if aligned items can be accessed directly					*/
+		static bool constexpr aligned_safe = ! big_endian;
+		/* type of message lengths, size_t of the platform, so that any
+		 * buffer is processed in one call. CHASKEY_SIZE_T narrows it, e.g.
+		 * to uint_fast16_t, then lengths are limited to its range			*/
+#	ifdef CHASKEY_SIZE_T
+		typedef CHASKEY_SIZE_T size_t;
+#	else
+		typedef decltype(sizeof(0)) size_t;
+#	endif
+		/* true if gcc vector extensions map on hardware SIMD registers	*/
+#	if defined(__SSE2__) || defined(__ARM_NEON) || defined(__ALTIVEC__)
+		static bool constexpr simd = true;
+#	else
+		static bool constexpr simd = false;
+#	endif
+		/* number of 32-bit lanes in the widest vector register				*/
+#	if defined(__AVX512F__)
+		static unsigned constexpr lanes = 16;
+#	elif defined(__AVX2__)
+		static unsigned constexpr lanes = 8;
+#	else
+		static unsigned constexpr lanes = 4;
+#	endif
+		/* number of blocks processed at once by modes running Cipher::Batch	*/
+		static unsigned constexpr run = simd ? 16 : 4;
+		/* true for 8 and 16-bit cores, that cannot keep two states in
+		 * registers																*/
+#	if defined(__AVR__) || defined(__MSP430__)
+		static bool constexpr narrow = true;
+#	else
+		static bool constexpr narrow = false;
+#	endif
+	};
+
 	inline bool equals(const void* a, const void* b, uint_fast8_t len) noexcept {
 		const uint8_t* l { reinterpret_cast<const uint8_t*>(a) };
 		const uint8_t* r { reinterpret_cast<const uint8_t*>(b) };
@@ -85,6 +161,64 @@ namespace details {
 		while(len--) res |= l[len] ^ r[len];
 		return res == 0;
 	}
+	/**
+	 * Runs CBC-MAC on a run of count full blocks of msg.
+	 * The state is copied to a local variable, so that the compiler
+	 * keeps it in registers through the loop, and written back once
+	 */
+	template<class Formatter, class Cipher, typename size_t>
+	inline void absorb(Cipher& cipher, const uint8_t* msg, size_t count) noexcept {
+		typedef typename Formatter::block_t block_t;
+		if( ! count ) return;
+		Cipher state;
+		block_t input;
+		state = cipher;
+		do {
+			Formatter::read(input, msg);
+			state ^= input;
+			state.permute();
+			msg += sizeof(block_t);
+		} while( --count );
+		cipher = state;
+	}
+	/** enables scatter-gather overloads for types with iov_base, iov_len	*/
+	template<typename iovec>
+	using if_iovec = decltype(static_cast<const iovec*>(nullptr)->iov_base,
+		static_cast<const iovec*>(nullptr)->iov_len, void());
+	/**
+	 * Calls fn(data, len, final) for each non-empty fragment of the
+	 * iovec-style array iov of count items. final is passed with the last
+	 * non-empty fragment only, so that the result is the same as of one
+	 * call on the fragments concatenated. Fragments longer than the range
+	 * of arch_traits::size_t are passed in pieces
+	 */
+	template<typename iovec, class Fn>
+	inline void gather(const iovec* iov, unsigned count, bool final, Fn&& fn)
+			noexcept {
+		typedef arch_traits::size_t size_t;
+		/* the largest multiple of 64 bytes, that size_t holds				*/
+		constexpr size_t piece = size_t(-1) - 63;
+		while( count && ! iov[count - 1].iov_len ) --count;
+		if( ! count ) {
+			if( final ) fn(nullptr, 0, true);
+			return;
+		}
+		for(unsigned i = 0; i < count; ++i) {
+			const uint8_t* data = static_cast<const uint8_t*>(iov[i].iov_base);
+			auto len = iov[i].iov_len;
+			for(; len > piece; len -= piece, data += piece)
+				fn(data, piece, false);
+			if( len ) fn(data, static_cast<size_t>(len), final && i + 1 == count);
+		}
+	}
+	/** stream over a plain buffer, used by the direct-to-buffer overloads	*/
+	struct writer {
+		uint8_t* data;
+		inline void write(const char* src, uint_fast8_t len) noexcept {
+			__builtin_memcpy(data, src, len);
+			data += len;
+		}
+	};
 }
 
 /**
@@ -158,10 +292,14 @@ public:
 	template<class stream>
 	inline void encrypt(stream&& output, const uint8_t* msg, size_t len, bool final) noexcept {
 		do {
+			/* runs of full blocks bypass the formatter					*/
+			auto run = buff.runs(msg, len);
+			if( run.count ) {
+				encrypt_runs(output, run.data, run.count);
+				if( ! len ) return;
+			}
 			if( ! encrypt(msg, len, final) ) return;
 			const block_t& result = buff.result(*this);
-			/* cast to match std::ostrem::write signature,
-			 * TODO cast to type of the first argument of write 			*/
 			output.write(reinterpret_cast<const char*>(result), sizeof(block_t));
 			buff.reset();
 		} while( len );
@@ -172,6 +310,9 @@ public:
 	template<class stream>
 	inline void decrypt(stream&& output, const uint8_t* msg, size_t len) noexcept {
 		do {
+			/* runs of full blocks bypass the formatter					*/
+			auto run = buff.runs(msg, len);
+			decrypt_runs(output, run.data, run.count);
 			buff.append(msg, len);
 			if( ! buff.full() ) {
 				return;
@@ -179,12 +320,52 @@ public:
 			Block block;
 			decrypt(buff.block(), block);
 			const block_t& result = buff.result(block);
-			/* cast to match std::ostrem::write signature,
-			 * TODO cast to type of the first argument of write 			*/
 			output.write(reinterpret_cast<const char*>(result), sizeof(block_t));
 			buff.reset();
 		} while( len );
 	}
+	/**
+	 * Encrypts message msg of length len into dst, which may be msg itself,
+	 * returns number of bytes written. With final == true dst must fit len
+	 * rounded up to the size of block
+	 */
+	inline size_t encrypt(uint8_t* dst, const uint8_t* msg, size_t len,
+			bool final) noexcept {
+		details::writer output { dst };
+		encrypt(output, msg, len, final);
+		return output.data - dst;
+	}
+	/**
+	 * Decrypts message msg of length len into dst, which may be msg itself,
+	 * returns number of bytes written
+	 */
+	inline size_t decrypt(uint8_t* dst, const uint8_t* msg, size_t len)
+			noexcept {
+		details::writer output { dst };
+		decrypt(output, msg, len);
+		return output.data - dst;
+	}
+	/**
+	 * Encrypts message gathered from count fragments of iov, an array of
+	 * iovec or of POSIX struct iovec, as if they were one chunk
+	 */
+	template<class stream, typename iovec, typename = details::if_iovec<iovec>>
+	inline void encrypt(stream&& output, const iovec* iov, unsigned count,
+			bool final) noexcept {
+		details::gather(iov, count, final,
+			[&](const uint8_t* msg, size_t len, bool last) {
+				encrypt(output, msg, len, last); });
+	}
+	/**
+	 * Decrypts message gathered from count fragments of iov
+	 */
+	template<class stream, typename iovec, typename = details::if_iovec<iovec>>
+	inline void decrypt(stream&& output, const iovec* iov, unsigned count)
+			noexcept {
+		details::gather(iov, count, false,
+			[&](const uint8_t* msg, size_t len, bool) {
+				decrypt(output, msg, len); });
+	}
 protected:
 	inline bool encrypt(const uint8_t*& msg, size_t& len, bool final) noexcept {
 		buff.append(msg, len);
@@ -209,12 +390,214 @@ protected:
 		output ^= *this;
 		static_cast<Block&>(*this) = input; /* Block is not directly visible */
 	}
+	/**
+	 * Encrypts count full blocks of msg, the state is copied to a local
+	 * variable, so that the compiler keeps it in registers
+	 */
+	template<class stream>
+	inline void encrypt_runs(stream&& output, const uint8_t* msg, size_t count) noexcept {
+		Cipher state;
+		block_t input;
+		state = static_cast<const Cipher&>(*this);
+		do {
+			Formatter::read(input, msg);
+			state ^= input;
+			state.permute();
+			state ^= key;
+			const block_t& result = buff.result(state);
+			output.write(reinterpret_cast<const char*>(result), sizeof(block_t));
+			msg += sizeof(block_t);
+		} while( --count );
+		static_cast<Cipher&>(*this) = state;
+	}
+	/** maximal and minimal number of blocks inverted at once				*/
+	static constexpr unsigned run = details::arch_traits::run;
+	static constexpr unsigned run_min = 4;
+	/**
+	 * Decrypts count full blocks of msg, in runs of at least run_min blocks.
+	 * Block i depends only on C[i] and C[i-1], so that runs of blocks are
+	 * inverted at once with Cipher::Batch::etumrep and then xored with
+	 * preceding cipher texts. Shorter tails are inverted one by one
+	 */
+	template<class stream>
+	inline void decrypt_runs(stream&& output, const uint8_t* msg, size_t count) noexcept {
+		block_t input[run], work[run];
+		const block_t& k = key;
+		constexpr unsigned N = sizeof(block_t) / sizeof(k[0]);
+		while( count >= run_min ) {
+			unsigned n = count < run ? count : run;
+			for(unsigned i = 0; i < n; ++i) {
+				Formatter::read(input[i], msg + i * sizeof(block_t));
+				for(unsigned j = N; j--; ) work[i][j] = input[i][j] ^ k[j];
+			}
+			Cipher::Batch::etumrep(work, n);
+			const block_t& state = *this;
+			for(unsigned i = 0; i < n; ++i) {
+				const block_t& chain = i ? input[i - 1] : state;
+				for(unsigned j = N; j--; ) work[i][j] ^= chain[j];
+				const block_t& result = buff.result(work[i]);
+				output.write(reinterpret_cast<const char*>(result), sizeof(block_t));
+			}
+			static_cast<Block&>(*this) = input[n - 1];
+			msg += n * sizeof(block_t);
+			count -= n;
+		}
+		for(; count; --count) {
+			Block block;
+			Formatter::read(input[0], msg);
+			decrypt(input[0], block);
+			const block_t& result = buff.result(block);
+			output.write(reinterpret_cast<const char*>(result), sizeof(block_t));
+			msg += sizeof(block_t);
+		}
+	}
 
 private:
 	Block key;
 	Formatter buff;
 };
 
+/**
+ * BlockCipher in the Counter Mode (CTR)
+ * http://nvlpubs.nist.gov/nistpubs/Legacy/SP/nistspecialpublication800-38a.pdf
+ * chapter 6.5
+ * Key stream block i is the cipher of counter block iv + i, where the
+ * counter block is a little endian number. Key stream blocks do not depend
+ * on each other and are generated in runs with Cipher::Batch::permute.
+ * No padding is applied, key stream can be positioned to any byte offset
+ *
+ * Usage:
+ * 		Ctr<Cipher,Formatter> ctr;
+ * 		ctr.set(key);
+ * 		ctr.init(iv);							// set initial counter block
+ * 		ctr.encrypt(out, datachunk, length);	// feed data by chunks
+ * 		ctr.encrypt(data, length);				// or encrypt in place
+ * 		ctr.seek(offset);						// random access
+ */
+template<class Cipher, class Formatter>
+class Ctr {
+public:
+	using block_t = typename Cipher::block_t;
+	using Block   = typename Cipher::Block;
+	using item_t  = typename Block::item_t;
+	typedef typename Formatter::size_t size_t;
+	typedef uint64_t offset_t;
+	inline Ctr() noexcept {}
+	inline Ctr(const Ctr&) = delete; /* no copy constructor */
+	explicit inline Ctr(const block_t&& _key) noexcept  { set(_key); }
+	explicit inline Ctr(const block_t& _key) noexcept { set(_key); }
+
+	/** set the secret key 													*/
+	inline void set(const block_t& _key) noexcept {	key = _key;	}
+	/** initialize the counter block with iv and seek to the beginning		*/
+	inline void init(const block_t& _iv) noexcept {
+		for(unsigned i = N; i--; ) iv[i] = _iv[i];
+		seek(0);
+	}
+	/** positions key stream at byte offset									*/
+	inline void seek(offset_t offset) noexcept {
+		next = offset / sizeof(block_t);
+		generate();
+		pos = offset % sizeof(block_t);
+	}
+	/** current byte offset of the key stream								*/
+	inline offset_t tell() const noexcept {
+		return (next - run) * sizeof(block_t) + pos;
+	}
+	/**
+	 * Encrypts message msg of length len and writes it to the output stream
+	 */
+	template<class stream>
+	inline void encrypt(stream&& output, const uint8_t* msg, size_t len) noexcept {
+		while( len ) {
+			size_t n = available(len);
+			uint8_t* ks = bytes() + pos;
+			xor_bytes(ks, msg, ks, n);
+			output.write(reinterpret_cast<const char*>(ks), n);
+			msg += n;
+			len -= n;
+			pos += n;
+		}
+	}
+	/** Encrypts data of length len in place								*/
+	inline void encrypt(uint8_t* data, size_t len) noexcept {
+		while( len ) {
+			size_t n = available(len);
+			xor_bytes(data, data, bytes() + pos, n);
+			data += n;
+			len -= n;
+			pos += n;
+		}
+	}
+	/**
+	 * Decrypts message msg of length len and writes it to the output stream
+	 */
+	template<class stream>
+	inline void decrypt(stream&& output, const uint8_t* msg, size_t len) noexcept {
+		encrypt(output, msg, len);
+	}
+	/** Decrypts data of length len in place								*/
+	inline void decrypt(uint8_t* data, size_t len) noexcept {
+		encrypt(data, len);
+	}
+protected:
+	static constexpr unsigned run = details::arch_traits::run;
+	static constexpr unsigned N = sizeof(block_t) / sizeof(item_t);
+	inline uint8_t* bytes() noexcept {
+		return reinterpret_cast<uint8_t*>(keystream);
+	}
+	/** dst = a ^ b, a whole block at a time where possible					*/
+	static inline void xor_bytes(uint8_t* dst, const uint8_t* a,
+			const uint8_t* b, size_t len) noexcept {
+		for(; len >= sizeof(block_t); len -= sizeof(block_t)) {
+			block_t x, y;
+			__builtin_memcpy(x, a, sizeof(x));
+			__builtin_memcpy(y, b, sizeof(y));
+			for(unsigned j = N; j--; ) x[j] ^= y[j];
+			__builtin_memcpy(dst, x, sizeof(x));
+			dst += sizeof(x); a += sizeof(x); b += sizeof(x);
+		}
+		while( len-- ) *dst++ = *a++ ^ *b++;
+	}
+	/** returns count of key stream bytes, up to len, available at pos		*/
+	inline size_t available(size_t len) noexcept {
+		if( pos == sizeof(keystream) ) {
+			generate();
+			pos = 0;
+		}
+		size_t n = sizeof(keystream) - pos;
+		return n < len ? n : len;
+	}
+	/** generates run blocks of key stream, starting with block next		*/
+	inline void generate() noexcept {
+		const block_t& k = key;
+		for(unsigned i = 0; i < run; ++i) {
+			/* counter block iv + next + i, little endian					*/
+			offset_t c = next + i;
+			uint_fast8_t carry = 0;
+			for(unsigned j = 0; j < N; ++j) {
+				uint64_t sum = static_cast<uint64_t>(iv[j])
+					+ static_cast<item_t>(c) + carry;
+				keystream[i][j] = static_cast<item_t>(sum) ^ k[j];
+				carry = sum >> (sizeof(item_t) * 8);
+				c = sizeof(item_t) < sizeof(c) ? c >> (sizeof(item_t) * 8) : 0;
+			}
+		}
+		Cipher::Batch::permute(keystream, run);
+		for(unsigned i = 0; i < run; ++i) {
+			for(unsigned j = N; j--; ) keystream[i][j] ^= k[j];
+			Formatter::final(keystream[i]);
+		}
+		next += run;
+	}
+private:
+	Block key;
+	block_t iv;
+	block_t keystream[run];
+	offset_t next;		/* index of the block following the key stream	*/
+	size_t pos;			/* bytes of the key stream used					*/
+};
+
 /**
  * BlockCipher in Authentication Mode
  * In this mode CBC is used to generate and verify message signature
@@ -237,7 +620,7 @@ class Mac : protected Cipher {
 public:
 	using typename Cipher::Block;
 	using typename Cipher::block_t;
-	using size_t = uint_fast16_t;		/* not expecting chunks larger 64K  */
+	using size_t = details::arch_traits::size_t;
 	inline Mac() noexcept {}
 	inline Mac(const Mac&) = delete; 	/* no copy constructor 				*/
 	explicit inline Mac(const block_t&& _key) noexcept  { set(_key); }
@@ -261,6 +644,10 @@ public:
 	inline void update(const uint8_t* msg, size_t len, bool final) noexcept {
 		Block* finalkey = &subkey1;
 		do {
+			/* full blocks, except the last one, bypass the formatter		*/
+			auto run = buff.runs(msg, len, true);
+			details::absorb<Formatter>(static_cast<Cipher&>(*this),
+				run.data, run.count);
 			buff.append(msg, len);
 			if( ! len ) {
 				if( final ) {
@@ -281,6 +668,14 @@ public:
 			buff.final(*this);
 		}
 	}
+	/** processes message gathered from count fragments of iov, an array of
+	 *  iovec or of POSIX struct iovec, as if they were one chunk			*/
+	template<typename iovec, typename = details::if_iovec<iovec>>
+	inline void update(const iovec* iov, unsigned count, bool final) noexcept {
+		details::gather(iov, count, final,
+			[this](const uint8_t* msg, size_t len, bool last) {
+				update(msg, len, last); });
+	}
 	/**
 	 * writes computed MAC to output
 	 * if all 16 bytes are not needed, use a stream that trims
@@ -298,7 +693,123 @@ public:
 			len < sizeof(block_t) ? len : sizeof(block_t));
 	}
 
+	/** key context for batch processing, same as kept in Mac				*/
+	struct context {
+		block_t key;
+		block_t subkey1;
+		block_t subkey2;
+		inline void set(const block_t& _key) noexcept {
+			for(unsigned i = sizeof(block_t)/sizeof(_key[0]); i--; )
+				key[i] = _key[i];
+			Cipher::derive(subkey1, key);
+			Cipher::derive(subkey2, subkey1);
+		}
+	};
+	/** one message of a batch												*/
+	struct item {
+		const context* key;
+		const uint8_t* msg;
+		size_t len;
+		const void* tag;		/* expected tag, used by verify only		*/
+	};
+	/**
+	 * computes tags of count independent messages, running them on the
+	 * lanes of Kernel. A lane that completes its message takes the next one
+	 * so that messages of unequal length keep all lanes busy
+	 */
+	template<class Kernel>
+	static void sign(block_t* tags, const item* items, unsigned count) noexcept {
+		batch<Kernel>(items, count, [tags](unsigned i, const block_t& tag) {
+			for(unsigned j = sizeof(block_t)/sizeof(tag[0]); j--; )
+				tags[i][j] = tag[j];
+		});
+	}
+	/**
+	 * verifies tags of count independent messages, sets bit i%32 of
+	 * mask[i/32] if item i is verified, returns true if all are verified
+	 */
+	template<class Kernel>
+	static bool verify(uint32_t* mask, const item* items,
+			unsigned count) noexcept {
+		for(unsigned i = (count + 31) / 32; i--; ) mask[i] = 0;
+		unsigned failed = 0;
+		batch<Kernel>(items, count,
+			[mask, items, &failed](unsigned i, const block_t& tag) {
+				if( details::equals(tag, items[i].tag, sizeof(block_t)) )
+					mask[i / 32] |= UINT32_C(1) << (i % 32);
+				else
+					++failed;
+			});
+		return failed == 0;
+	}
+
 protected:
+	/**
+	 * per lane scheduler for sign and verify,
+	 * done(i, tag) is called as soon as message i is completed
+	 */
+	template<class Kernel, class Done>
+	static void batch(const item* items, unsigned count, Done&& done) noexcept {
+		constexpr unsigned L = Kernel::lanes;
+		const uint8_t* msg[L];
+		size_t len[L];
+		const context* keys[L];
+		unsigned active[L];		/* index of item in lane, count if idle		*/
+		const block_t* last[L];	/* subkey, if lane runs its final block		*/
+		block_t input[L] = {};
+		Kernel state {}, in;
+		unsigned next = 0, busy = 0;
+		for(unsigned l = 0; l < L; ++l) {
+			active[l] = count;
+			last[l] = nullptr;
+		}
+		do {
+			for(unsigned l = 0; l < L; ++l) {
+				if( active[l] == count ) {
+					if( next == count ) continue;
+					/* idle lane takes the next message					*/
+					active[l] = next;
+					keys[l] = items[next].key;
+					msg[l] = items[next].msg;
+					len[l] = items[next].len;
+					state.load(l, keys[l]->key);
+					++next;
+					++busy;
+				}
+				if( len[l] > sizeof(block_t) ) {
+					Formatter::read(input[l], msg[l]);
+					msg[l] += sizeof(block_t);
+					len[l] -= sizeof(block_t);
+				} else {
+					/* final block, padded and xored with the subkey		*/
+					Formatter buff;
+					buff.append(msg[l], len[l]);
+					last[l] = &keys[l]->subkey1;
+					if( ! buff.full() ) {
+						buff.pad(1);
+						last[l] = &keys[l]->subkey2;
+					}
+					for(unsigned j = sizeof(block_t)/sizeof(input[l][0]); j--;)
+						input[l][j] = buff.block()[j] ^ (*last[l])[j];
+				}
+			}
+			in.load(input);
+			state ^= in;
+			state.permute();
+			for(unsigned l = 0; l < L; ++l) {
+				if( ! last[l] ) continue;
+				block_t tag;
+				state.store(l, tag);
+				for(unsigned j = sizeof(block_t)/sizeof(tag[0]); j--; )
+					tag[j] ^= (*last[l])[j];
+				Formatter::final(tag);
+				done(active[l], tag);
+				active[l] = count;
+				last[l] = nullptr;
+				--busy;
+			}
+		} while( busy || next < count );
+	}
 	inline void encrypt(const block_t& input) noexcept {
 		/* nistspecialpublication800-38b.pdf 6.2
 		 * says M1 should be transformed without first xoring
@@ -315,166 +826,1290 @@ private:
 };
 
 /**
- * BlockCipher in CLOC Mode https://eprint.iacr.org/2014/157.pdf [157]
- * In this mode CBC is used to provide both authentication and encryption
+ * BlockCipher in Encrypt-then-MAC mode, Cbc encryption of the message and
+ * Mac of its cipher text under an independent key, computed in one pass.
+ * Mac of cipher block i and Cbc of plain block i+1 do not depend on each
+ * other, they are transformed side by side as two states of Cipher::Pair,
+ * so that the two dependency chains hide each other's latency.
+ * The last cipher block is held until the next one or the final chunk,
+ * where it is signed alone with the Mac subkey. Cipher text is always a
+ * multiple of the block size, so the other subkey is never used.
+ * Results are same as Cbc::encrypt of the message followed by
+ * Mac::update of the entire cipher text with final == true
  *
  * Usage:
- * 		Cloc<Cipher,Formater> cloc;
- * 		cloc.set(key);
- * 		cloc.init(); 							// when reusing instance
- * 		cloc.update(adchunk, length, false);	// feed AD by chunks
- * 		cloc.update(lastadchunk, length, true); // feed last AD chunk
- * 		cloc.nonce(nonce, length);				// feed noce
- * 		cloc.encrypt(out, datachunk, false);	// feed data by chunks
- * 		cloc.encrypt(out, lastdatachunk, true);	// feed last data chunk
+ * 		Etm<Cipher,Formatter> etm;
+ * 		etm.set(enckey, mackey);
+ * 		etm.init(nonce, length); 				// or init(iv)
+ * 		etm.encrypt(out, datachunk, false);		// feed data by chunks
+ * 		etm.encrypt(out, lastdatachunk, true);	// feed last data chunk
+ * 		etm.write(tag);							// write computed tag to out
+ * 		etm.decrypt(out, datachunk, final);		// on the receiving side
+ * 		etm.verify(tag, taglen);				// and verify tag
  */
 template<class Cipher, class Formatter>
-class Cloc {
+class Etm {
 public:
 	using Block   = typename Cipher::Block;
 	using item_t  = typename Block::item_t;
 	using block_t = typename Cipher::block_t;
-	using size_t = uint_fast16_t;		/* not expecting chunks larger 64K  */
-	inline Cloc() noexcept {}
-	inline Cloc(const Cloc&) = delete; 	/* no copy constructor 				*/
-	explicit inline Cloc(const block_t&& _key) noexcept  { set(_key); }
-	explicit inline Cloc(const block_t& _key) noexcept { set(_key); }
-
-	/** sets the secret key to use 											*/
-	inline void set(const block_t& _key) noexcept {
-		key = _key;
-		init();
+	using Pair    = typename Cipher::Pair;
+	typedef typename Formatter::size_t size_t;
+	inline Etm() noexcept {}
+	inline Etm(const Etm&) = delete; /* no copy constructor */
+	inline Etm(const block_t& enckey, const block_t& mackey) noexcept {
+		set(enckey, mackey);
 	}
-	/**
-	 * Initializes vector by running forward cipher function on nonce
-	 */
-	inline void init() noexcept {
-		enc       = key;
-		ozp       = false;
-		finalized = false;
-		fix0guard = false;
-		g1g2guard = false;
-		nonceguard = false;
-		buff.reset();
+
+	/** sets the secret keys, encryption and authentication keys must be
+	 *  independent															*/
+	inline void set(const block_t& enckey, const block_t& mackey) noexcept {
+		key = enckey;
+		authkey = mackey;
+		Cipher::derive(subkey, authkey);
+	}
+	/** initializes the cipher with initialization vector iv, as Cbc::init	*/
+	inline void init(const block_t& iv) noexcept {
+		state = key;
+		state ^= iv;
+		reset();
 	}
-	/** Processes chunk of associated data msg of length len,
-	 *  final finishes generation by padding the message to the size of
-	 *  block and applying one of derived keys.
-	 *  Corresponds to the first part of HASH, see Fig 3 of [157]			*/
-	inline void update(const uint8_t* msg, size_t len, bool final) noexcept {
+	/** initializes vector by running forward cipher function on nonce,
+	 *  as Cbc::init																*/
+	inline void init(const void* nonce, size_t len) noexcept {
+		block_t k;
+		Cipher::derive(k, key);
+		state = k;
+		const uint8_t* msg = (const uint8_t*)nonce;
 		do {
 			buff.append(msg, len);
-			if( ! len ) {
-				if( ! buff.full() ) {
-					if( final )
-						ozp = buff.pad(0x80);		/* apply ozp 			*/
-					else
-						return;
-				}
-			}
-			bool fixed0 = !fix0guard && fix0(enc);
-			update(buff.block());
-			fix0guard = true;
-			if( fixed0 ) h(enc);
+			if( ! buff.full() ) buff.pad(0);
+			encrypt(buff.block());
 			buff.reset();
 		} while( len );
-	}
-	/** Processes nonce monce of length len in one chunk
-	 *  Corresponds to the last part of HASH, see Fig 3 of [157]			*/
-	inline void nonce(const uint8_t* monce, size_t len) {
-		/* if buffer is not empty call update for final block				*/
-		if( buff.available() ) update(monce,0,true);
-		if( monce )	buff.append(monce, len);
-		buff.pad(0x80);								/* apply ozp 			*/
-		enc ^= buff.block();
-		if( ozp ) f2(enc);
-		else f1(enc);
-		tag = enc;
-		enc.permute();		/* corresponds to V->EK on fig.4				*/
-		enc ^= key;
-		buff.reset();
-		nonceguard = true;
+		reset();
 	}
 	/**
-	 * Encrypts message msg of length len and writes it to the output stream
-	 * if final == true, the message is padded o the size of block
+	 * Encrypts message msg of length len, writes it to the output stream
+	 * and signs the cipher text.
+	 * If final == true, the message is padded to the size of block and
+	 * the tag is computed
 	 */
 	template<class stream>
 	inline void encrypt(stream&& output, const uint8_t* msg, size_t len, bool final) noexcept {
-		if( ! nonceguard ) nonce(nullptr,0);
 		do {
-			uint_fast8_t size;
-			if( ! (size = process(msg, len, final)) ) return;
-			const block_t& result = buff.result(enc);
-			output.write(reinterpret_cast<const char*>(result), size);
-			prf(false, size);
+			/* runs of full blocks bypass the formatter					*/
+			if( held ) {
+				auto run = buff.runs(msg, len);
+				if( run.count ) {
+					encrypt_runs(output, run.data, run.count);
+					if( ! len ) break;
+				}
+			}
+			buff.append(msg, len);
+			if( ! buff.full() ) {
+				if( final ) buff.pad(0);
+				else return;
+			}
+			if( held )
+				step(buff.block());
+			else
+				encrypt(buff.block());
+			held = true;
+			const block_t& result = buff.result(state);
+			output.write(reinterpret_cast<const char*>(result), sizeof(block_t));
 			buff.reset();
 		} while( len );
+		if( final ) finish();
 	}
-
 	/**
-	 * Decrypts ciphertext msg of length len and writes it to the output stream
-	 * if final == true, the message is padded o the size of block
+	 * Signs cipher text msg of length len, decrypts it and writes to the
+	 * output stream. If final == true, the tag is computed.
+	 * Total length of the cipher text must be a multiple of the block size
 	 */
 	template<class stream>
 	inline void decrypt(stream&& output, const uint8_t* msg, size_t len, bool final) noexcept {
-		Formatter buf;
-		if( ! nonceguard ) nonce(nullptr,0);
 		do {
-			uint_fast8_t size;
-			if( ! (size = process(msg, len, final)) ) return;
-			const block_t& result = buf.result(enc);
-			output.write(reinterpret_cast<const char*>(result), size);
-			prf(true, size);
+			/* runs of full blocks bypass the formatter					*/
+			auto run = buff.runs(msg, len);
+			decrypt_runs(output, run.data, run.count);
+			buff.append(msg, len);
+			if( ! buff.full() ) break;
+			decrypt(output, buff.block());
 			buff.reset();
 		} while( len );
+		if( final ) finish();
 	}
 	/**
 	 * writes computed MAC to output
 	 * if all 16 bytes are not needed, use a stream that trims
 	 */
 	template<class stream>
-	void write(stream&& output) const noexcept {
-		finalize();
-		output.write(reinterpret_cast<const char*>(tag.raw()),Cipher::size());
+	inline void write(stream&& output) const noexcept {
+		output.write(reinterpret_cast<const char*>(mac.raw()), mac.size());
 	}
 	/**
 	 * verifies computed MAC against provided externally tag
 	 */
 	inline bool
-	verify(const void* _tag, uint_fast8_t len=sizeof(block_t)) const noexcept {
-		finalize();
-		return details::equals(tag, _tag,
+	verify(const void* tag,uint_fast8_t len=sizeof(block_t)) const noexcept {
+		return details::equals(mac.raw(), tag,
 			len < sizeof(block_t) ? len : sizeof(block_t));
 	}
-
 protected:
-	inline void finalize() const  noexcept {
-		if( ! finalized ) {
-			Formatter::final(tag);
-			finalized = true;
-		}
-	}
-	inline void update(const block_t& input) noexcept {
-		enc  ^= input;
-		enc.permute();
-		enc  ^= key;
-	}
-	inline void cipher() noexcept {
-		tag.permute();
-		tag  ^= key;
+	static constexpr unsigned N = sizeof(block_t) / sizeof(item_t);
+	inline void reset() noexcept {
+		mac = authkey;
+		held = false;
+		buff.reset();
 	}
-	inline bool nodata(bool final) noexcept {
-		if( final ) {
-			if( ! g1g2guard && ! buff.available() ) {
-				g1(tag);
-				cipher();
-			} else {
-				buff.pad(0);
-				return false;
-			}
+	/** decrypts and signs one cipher block									*/
+	template<class stream>
+	inline void decrypt(stream&& output, const block_t& input) noexcept {
+		Block block;
+		block = input;
+		block ^= key;
+		Cipher::cast(block).etumrep();
+		block ^= state;
+		absorb(input);
+		const block_t& result = buff.result(block);
+		output.write(reinterpret_cast<const char*>(result), sizeof(block_t));
+	}
+	/** Cbc transformation of one block, as Cbc::encrypt						*/
+	inline void encrypt(const block_t& input) noexcept {
+		state ^= input;
+		state.permute();
+		state ^= key;
+	}
+	/** Mac transformation of the held cipher block, if any, and holds
+	 *  cipher block input instead												*/
+	inline void absorb(const block_t& input) noexcept {
+		if( held ) {
+			mac ^= state;
+			mac.permute();
 		}
-		return true;
+		state = input;
+		held = true;
+	}
+	/** Cbc of input along with Mac of the held cipher block					*/
+	inline void step(const block_t& input) noexcept {
+		block_t x, y;
+		const block_t& s = state;
+		const block_t& m = mac;
+		for(unsigned j = N; j--; ) {
+			x[j] = s[j] ^ input[j];
+			y[j] = m[j] ^ s[j];
+		}
+		Pair pair;
+		pair.load(0, x);
+		pair.load(1, y);
+		pair.permute();
+		pair.store(0, x);
+		pair.store(1, y);
+		state = x;
+		state ^= key;
+		mac = y;
+	}
+	/** signs the held cipher block with the subkey and finalizes the tag	*/
+	inline void finish() noexcept {
+		if( ! held ) return;
+		mac ^= state;
+		mac ^= subkey;
+		mac.permute();
+		mac ^= subkey;
+		Formatter::final(mac);
+		held = false;
+	}
+	/**
+	 * Encrypts count full blocks of msg with step, states are kept in local
+	 * variables, so that the compiler keeps them in registers. flatten
+	 * makes sure Pair rounds are inlined in large translation units
+	 */
+	template<class stream>
+	__attribute__((flatten))
+	inline void encrypt_runs(stream&& output, const uint8_t* msg, size_t count) noexcept {
+		block_t s, m, x, y;
+		const block_t& k = key;
+		for(unsigned j = N; j--; ) {
+			s[j] = static_cast<const block_t&>(state)[j];
+			m[j] = static_cast<const block_t&>(mac)[j];
+		}
+		Pair pair;
+		do {
+			Formatter::read(x, msg);
+			for(unsigned j = N; j--; ) {
+				x[j] ^= s[j];
+				y[j] = m[j] ^ s[j];
+			}
+			pair.load(0, x);
+			pair.load(1, y);
+			pair.permute();
+			pair.store(0, s);
+			pair.store(1, m);
+			for(unsigned j = N; j--; ) s[j] ^= k[j];
+			const block_t& result = buff.result(s);
+			output.write(reinterpret_cast<const char*>(result), sizeof(block_t));
+			msg += sizeof(block_t);
+		} while( --count );
+		state = s;
+		mac = m;
+	}
+	/** maximal and minimal number of blocks inverted at once				*/
+	static constexpr unsigned run = details::arch_traits::run;
+	static constexpr unsigned run_min = 4;
+	/**
+	 * Decrypts count full blocks of msg in runs, as Cbc::decrypt_runs, and
+	 * signs the cipher text of the run while it is at hand
+	 */
+	template<class stream>
+	inline void decrypt_runs(stream&& output, const uint8_t* msg, size_t count) noexcept {
+		block_t input[run], work[run];
+		const block_t& k = key;
+		while( count >= run_min ) {
+			unsigned n = count < run ? count : run;
+			for(unsigned i = 0; i < n; ++i) {
+				Formatter::read(input[i], msg + i * sizeof(block_t));
+				for(unsigned j = N; j--; ) work[i][j] = input[i][j] ^ k[j];
+			}
+			Cipher::Batch::etumrep(work, n);
+			for(unsigned i = 0; i < n; ++i) {
+				const block_t& chain = state;
+				for(unsigned j = N; j--; ) work[i][j] ^= chain[j];
+				absorb(input[i]);
+				const block_t& result = buff.result(work[i]);
+				output.write(reinterpret_cast<const char*>(result), sizeof(block_t));
+			}
+			msg += n * sizeof(block_t);
+			count -= n;
+		}
+		for(; count; --count) {
+			Formatter::read(input[0], msg);
+			decrypt(output, input[0]);
+			msg += sizeof(block_t);
+		}
+	}
+private:
+	Block key;
+	Block authkey;
+	Block subkey;
+	Cipher state;		/* Cbc state, the held cipher block if held		*/
+	Cipher mac;			/* Mac state, the tag when finished				*/
+	bool held;
+	Formatter buff;
+};
+
+/**
+ * BlockCipher in PMAC Mode, parallelizable message authentication
+ * http://web.cs.ucdavis.edu/~rogaway/ocb/pmac-bak.htm
+ * Block i of the message, but the last one, is masked with offset delta_i
+ * and transformed independently: sum ^= E(M[i] ^ delta_i), where
+ * E(x) = P(x ^ K) ^ K. Offsets are built from the table of doublings of
+ * L = E(0) with Cipher::derive, in the Gray code order, as in OCB3:
+ * 		L_* = E(0), L_$ = 2·L_*, L_0 = 2·L_$, L_i = 2·L_(i-1)
+ * 		delta_i = delta_(i-1) ^ L_ntz(i)
+ * The last block is xored to the sum as is, if full, with L_$ added,
+ * otherwise padded, tag = E(sum).
+ * Independent transformations are run with Cipher::Batch::permute, segments
+ * of a large message may be absorbed concurrently and their sums xored.
+ *
+ * Usage:
+ * 		Pmac<Cipher,Formatter> pmac;
+ * 		pmac.set(key);
+ * 		pmac.init(); 							// when reusing instance
+ * 		pmac.update(datachunk, false);			// feed data by chunks
+ * 		pmac.update(lastdatachunk, true);		// feed last data chunk
+ * 		pmac.write(out);						// write computed tag to out
+ * 		pmac.verify(tag, taglen);				// or verify tag
+ * or, with segments on threads:
+ * 		Pmac<Cipher,Formatter>::context ctx;
+ * 		ctx.set(key);
+ * 		Pmac::absorb(sum1, ctx, 1, msg, n);		// blocks 1..n, thread 1
+ * 		Pmac::absorb(sum2, ctx, n+1, msg+n*16, m);// blocks n+1..n+m, thread 2
+ * 		Pmac::finish(tag, ctx, sum, last, lastlen);	// sum = sum1 ^ sum2
+ */
+template<class Cipher, class Formatter>
+class Pmac : protected Cipher {
+public:
+	using typename Cipher::Block;
+	using typename Cipher::block_t;
+	using item_t = typename Block::item_t;
+	using size_t = typename Formatter::size_t;
+	typedef uint64_t index_t;				/* 1-based index of a block		*/
+	/* offsets L_0..L_63, one per bit of index_t, cover any block index	*/
+	static constexpr unsigned levels = sizeof(index_t) * 8;
+	inline Pmac() noexcept {}
+	inline Pmac(const Pmac&) = delete; 	/* no copy constructor 				*/
+	explicit inline Pmac(const block_t&& _key) noexcept  { set(_key); }
+	explicit inline Pmac(const block_t& _key) noexcept { set(_key); }
+
+	/** key context with precomputed table of offsets						*/
+	struct context {
+		block_t key;
+		block_t lstar;
+		block_t ldollar;
+		block_t l[levels];
+		inline void set(const block_t& _key) noexcept {
+			Cipher cipher;
+			cipher = _key;
+			cipher.permute();
+			cipher ^= _key;
+			const block_t& zero = cipher;
+			for(unsigned i = N; i--; ) {
+				key[i] = _key[i];
+				lstar[i] = zero[i];
+			}
+			Cipher::derive(ldollar, lstar);
+			Cipher::derive(l[0], ldollar);
+			for(unsigned i = 1; i < levels; ++i)
+				Cipher::derive(l[i], l[i - 1]);
+		}
+		/** computes offset of block i, delta_0 is zero					*/
+		inline void offset(block_t& delta, index_t i) const noexcept {
+			for(unsigned j = N; j--; ) delta[j] = 0;
+			for(index_t gray = i ^ (i >> 1); gray; gray &= gray - 1) {
+				const block_t& li = l[__builtin_ctzll(gray)];
+				for(unsigned j = N; j--; ) delta[j] ^= li[j];
+			}
+		}
+		/** advances offset from block i - 1 to block i					*/
+		inline void next(block_t& delta, index_t i) const noexcept {
+			const block_t& li = l[__builtin_ctzll(i)];
+			for(unsigned j = N; j--; ) delta[j] ^= li[j];
+		}
+	};
+
+	/** sets the secret key to use 											*/
+	inline void set(const block_t& _key) noexcept {
+		ctx.set(_key);
+		init();
+	}
+	/** initializes the state												*/
+	inline void init() noexcept {
+		for(unsigned j = N; j--; ) sum[j] = delta[j] = 0;
+		index = 0;
+		queued = 0;
+		held = false;
+		buff.reset();
+	}
+	/** processes message chunk msg of length len,
+	 *  final finishes generation by xoring the last block to the sum 		*/
+	inline void update(const uint8_t* msg, size_t len, bool final) noexcept {
+		while( len ) {
+			if( held ) {
+				push(last);
+				held = false;
+			}
+			/* full blocks, except the last one, bypass the formatter		*/
+			auto run = buff.runs(msg, len, true);
+			if( run.count ) push(run.data, run.count);
+			buff.append(msg, len);
+			/* full block is kept until more data is appended, it may
+			 * reference the caller's chunk, therefore it is copied		*/
+			if( buff.full() ) {
+				const block_t& block = buff.block();
+				for(unsigned j = N; j--; ) last[j] = block[j];
+				held = true;
+				buff.reset();
+			}
+		}
+		if( final ) {
+			flush(sum, ctx, work, queued);
+			queued = 0;
+			if( ! held ) buff.pad(1);
+			finish(static_cast<Cipher&>(*this), ctx, sum,
+				held ? last : buff.block(), held);
+		}
+	}
+	/**
+	 * writes computed MAC to output
+	 * if all 16 bytes are not needed, use a stream that trims
+	 */
+	template<class stream>
+	inline void write(stream&& output) const noexcept {
+		output.write(reinterpret_cast<const char*>(Cipher::raw()),Cipher::size());
+	}
+	/**
+	 * verifies computed MAC against provided externally tag
+	 */
+	inline bool
+	verify(const void* tag,uint_fast8_t len=sizeof(block_t)) const noexcept {
+		return details::equals(Cipher::raw(), tag,
+			len < sizeof(block_t) ? len : sizeof(block_t));
+	}
+	/** computed MAC as a block, bytes are in the order of write			*/
+	inline const block_t& tag() const noexcept {
+		return *this;
+	}
+	/** key context in use													*/
+	inline const context& keys() const noexcept {
+		return ctx;
+	}
+	/**
+	 * xors to sum transformed count full blocks of msg, first of which has
+	 * index first. Segments of one message may be absorbed concurrently,
+	 * each into its own sum
+	 */
+	static void absorb(block_t& sum, const context& ctx, index_t first,
+			const uint8_t* msg, index_t count) noexcept {
+		block_t mask, work[run];
+		ctx.offset(mask, first - 1);
+		for(unsigned j = N; j--; ) mask[j] ^= ctx.key[j];
+		while( count ) {
+			unsigned n = count < run ? count : run;
+			for(unsigned i = 0; i < n; ++i) {
+				block_t in;
+				ctx.next(mask, first + i);
+				Formatter::read(in, msg + i * sizeof(block_t));
+				for(unsigned j = N; j--; ) work[i][j] = in[j] ^ mask[j];
+			}
+			flush(sum, ctx, work, n);
+			first += n;
+			msg   += n * sizeof(block_t);
+			count -= n;
+		}
+	}
+	/**
+	 * computes tag from sum of all blocks but the last one
+	 * and the last block of length len, 0 <= len <= sizeof(block_t)
+	 */
+	static void finish(block_t& tag, const context& ctx, const block_t& sum,
+			const uint8_t* last, size_t len) noexcept {
+		Formatter buff;
+		Cipher cipher;
+		buff.append(last, len);
+		const bool full = buff.full();
+		if( ! full ) buff.pad(1);
+		finish(cipher, ctx, sum, buff.block(), full);
+		const block_t& result = cipher;
+		for(unsigned j = N; j--; ) tag[j] = result[j];
+	}
+	/** computes tag of message msg of length len in one call				*/
+	static void sign(block_t& tag, const context& ctx, const uint8_t* msg,
+			size_t len) noexcept {
+		/* all full blocks but the last one are absorbed directly		*/
+		size_t body = len ? (len - 1) / sizeof(block_t) : 0;
+		block_t sum = {};
+		absorb(sum, ctx, 1, msg, body);
+		finish(tag, ctx, sum, msg + body * sizeof(block_t),
+			len - body * sizeof(block_t));
+	}
+
+protected:
+	static constexpr unsigned run = details::arch_traits::run;
+	static constexpr unsigned N = sizeof(block_t) / sizeof(item_t);
+	/** queues block M[i] ^ delta_i ^ K, transforms run of queued blocks	*/
+	inline void push(const block_t& input) noexcept {
+		ctx.next(delta, ++index);
+		for(unsigned j = N; j--; )
+			work[queued][j] = input[j] ^ delta[j] ^ ctx.key[j];
+		if( ++queued == run ) {
+			flush(sum, ctx, work, run);
+			queued = 0;
+		}
+	}
+	/** queues count full blocks of msg. Mask delta ^ K and index are kept
+	 *  in locals so that stores to work do not force their reloads		*/
+	inline void push(const uint8_t* msg, size_t count) noexcept {
+		block_t mask;
+		index_t x = index;
+		unsigned q = queued;
+		for(unsigned j = N; j--; ) mask[j] = delta[j] ^ ctx.key[j];
+		while( count ) {
+			unsigned n = run - q;
+			if( n > count ) n = count;
+			for(unsigned i = q; i < q + n; ++i) {
+				block_t in;
+				ctx.next(mask, ++x);
+				Formatter::read(in, msg);
+				for(unsigned j = N; j--; ) work[i][j] = in[j] ^ mask[j];
+				msg += sizeof(block_t);
+			}
+			count -= n;
+			if( (q += n) == run ) {
+				flush(sum, ctx, work, run);
+				q = 0;
+			}
+		}
+		for(unsigned j = N; j--; ) delta[j] = mask[j] ^ ctx.key[j];
+		index = x;
+		queued = q;
+	}
+	/** transforms count blocks of work and xors them to sum				*/
+	static inline void flush(block_t& sum, const context& ctx,
+			block_t* work, unsigned count) noexcept {
+		if( ! count ) return;
+		Cipher::Batch::permute(work, count);
+		/* key is xored once per pair of blocks							*/
+		if( count & 1 )
+			for(unsigned j = N; j--; ) sum[j] ^= ctx.key[j];
+		for(unsigned i = 0; i < count; ++i)
+			for(unsigned j = N; j--; ) sum[j] ^= work[i][j];
+	}
+	/** transforms the sum with the last block, padded unless full		*/
+	static inline void finish(Cipher& cipher, const context& ctx,
+			const block_t& sum, const block_t& last, bool full) noexcept {
+		cipher = sum;
+		cipher ^= last;
+		if( full ) cipher ^= ctx.ldollar;
+		cipher ^= ctx.key;
+		cipher.permute();
+		cipher ^= ctx.key;
+		Formatter::final(cipher);
+	}
+private:
+	context ctx;
+	block_t sum;
+	block_t delta;
+	block_t work[run];
+	block_t last;
+	index_t index;
+	unsigned queued;
+	bool held;
+	Formatter buff;
+};
+
+/**
+ * BlockCipher in EAX Mode http://web.cs.ucdavis.edu/~rogaway/papers/eax.pdf
+ * with PMAC in place of OMAC, a parallelizable alternative to CLOC.
+ * 		N = PMAC(0 || nonce), H = PMAC(1 || ad), C = CTR(N, plaintext)
+ * 		tag = N ^ H ^ PMAC(2 || C)
+ * where prefixes 0, 1, 2 are full blocks with the number in the last byte.
+ * Key stream and PMAC both run on Cipher::Batch, ciphertext is signed
+ * right after it is produced, piece by piece of the key stream size, so
+ * that data is read from memory once.
+ *
+ * Usage is the same as of Cloc:
+ * 		Eax<Cipher,Formater> eax;
+ * 		eax.set(key);
+ * 		eax.init(); 							// when reusing instance
+ * 		eax.update(adchunk, length, false);		// feed AD by chunks
+ * 		eax.update(lastadchunk, length, true);	// feed last AD chunk
+ * 		eax.nonce(nonce, length);				// feed noce
+ * 		eax.encrypt(out, datachunk, false);		// feed data by chunks
+ * 		eax.encrypt(out, lastdatachunk, true);	// feed last data chunk
+ */
+template<class Cipher, class Formatter>
+class Eax {
+public:
+	using Block   = typename Cipher::Block;
+	using item_t  = typename Block::item_t;
+	using block_t = typename Cipher::block_t;
+	using size_t  = typename Formatter::size_t;
+	inline Eax() noexcept {}
+	inline Eax(const Eax&) = delete; 	/* no copy constructor 				*/
+	explicit inline Eax(const block_t&& _key) noexcept  { set(_key); }
+	explicit inline Eax(const block_t& _key) noexcept { set(_key); }
+
+	/** sets the secret key to use 											*/
+	inline void set(const block_t& _key) noexcept {
+		mac.set(_key);
+		ctr.set(_key);
+		init();
+	}
+	/** initializes state for a new message								*/
+	inline void init() noexcept {
+		mac.init();
+		prefix(1);
+		adguard    = false;
+		nonceguard = false;
+	}
+	/** Processes chunk of associated data msg of length len,
+	 *  final finishes H = PMAC(1 || ad)									*/
+	inline void update(const uint8_t* msg, size_t len, bool final) noexcept {
+		mac.update(msg, len, final);
+		if( final ) {
+			copy(tag, mac.tag());
+			adguard = true;
+		}
+	}
+	/** Processes nonce monce of length len in one chunk,
+	 *  computes N = PMAC(0 || nonce) and starts the key stream with it	*/
+	inline void nonce(const uint8_t* monce, size_t len) noexcept {
+		if( ! adguard ) update(nullptr, 0, true);
+		mac.init();
+		prefix(0);
+		mac.update(monce, len, true);
+		block_t iv;
+		copy(iv, mac.tag());
+		for(unsigned j = N; j--; ) tag[j] ^= iv[j];
+		/* tag is kept in the output byte order, counter in words		*/
+		Formatter::final(iv);
+		ctr.init(iv);
+		mac.init();
+		prefix(2);
+		nonceguard = true;
+	}
+	/**
+	 * Encrypts message msg of length len and writes it to the output stream
+	 * if final == true, the tag is computed
+	 */
+	template<class stream>
+	inline void encrypt(stream&& output, const uint8_t* msg, size_t len, bool final) noexcept {
+		if( ! nonceguard ) nonce(nullptr,0);
+		/* ctr writes pieces of its key stream, they are signed and
+		 * passed to the output while still in cache					*/
+		ctr.encrypt(signer<stream>{mac, output}, msg, len);
+		if( final ) finish();
+	}
+	/**
+	 * Decrypts ciphertext msg of length len and writes it to the output stream
+	 * if final == true, the tag is computed
+	 */
+	template<class stream>
+	inline void decrypt(stream&& output, const uint8_t* msg, size_t len, bool final) noexcept {
+		if( ! nonceguard ) nonce(nullptr,0);
+		while( len ) {
+			size_t n = len < piece ? len : piece;
+			mac.update(msg, n, false);
+			ctr.decrypt(output, msg, n);
+			msg += n;
+			len -= n;
+		}
+		if( final ) finish();
+	}
+	/**
+	 * writes computed MAC to output
+	 * if all 16 bytes are not needed, use a stream that trims
+	 */
+	template<class stream>
+	void write(stream&& output) const noexcept {
+		output.write(reinterpret_cast<const char*>(tag), sizeof(tag));
+	}
+	/**
+	 * verifies computed MAC against provided externally tag
+	 */
+	inline bool
+	verify(const void* _tag, uint_fast8_t len=sizeof(block_t)) const noexcept {
+		return details::equals(tag, _tag,
+			len < sizeof(block_t) ? len : sizeof(block_t));
+	}
+protected:
+	using Mac = Pmac<Cipher,Formatter>;
+	static constexpr unsigned N = sizeof(block_t) / sizeof(item_t);
+	/* bytes decrypted per step, same as the key stream generated at once	*/
+	static constexpr size_t piece = details::arch_traits::run * sizeof(block_t);
+	/** passes data to both mac and output stream							*/
+	template<class stream>
+	struct signer {
+		Mac& mac;
+		stream& output;
+		inline void write(const char* data, size_t len) noexcept {
+			mac.update(reinterpret_cast<const uint8_t*>(data), len, false);
+			output.write(data, len);
+		}
+	};
+	/** feeds domain prefix, a full block with t in the last byte			*/
+	inline void prefix(uint8_t t) noexcept {
+		uint8_t block[sizeof(block_t)] = {};
+		block[sizeof(block) - 1] = t;
+		mac.update(block, sizeof(block), false);
+	}
+	inline void finish() noexcept {
+		mac.update(nullptr, 0, true);
+		const block_t& c = mac.tag();
+		for(unsigned j = N; j--; ) tag[j] ^= c[j];
+	}
+	static inline void copy(block_t& dst, const block_t& src) noexcept {
+		for(unsigned j = N; j--; ) dst[j] = src[j];
+	}
+private:
+	Mac mac;
+	Ctr<Cipher,Formatter> ctr;
+	block_t tag;
+	bool adguard;
+	bool nonceguard;
+};
+
+/**
+ * BlockCipher in XEX Mode, tweakable sector encryption
+ * http://web.cs.ucdavis.edu/~rogaway/papers/offsets.pdf
+ * Block j of sector s is encrypted as
+ * 		C = E(M ^ delta_j) ^ delta_j, delta_j = 2^(j+1)·L, L = E(s)
+ * where E(x) = P(x ^ K) ^ K and doubling is done with Cipher::derive.
+ * Sectors are independent, so any of them is decrypted alone, and blocks
+ * of a sector are transformed in runs with Cipher::Batch.
+ * If sector size is not a multiple of the block size, the last full block
+ * and the tail are encrypted with ciphertext stealing, as in XTS:
+ * 		CC = XEX_(m-1)(M[m-1]), C[m] = CC[0..r), C[m-1] = XEX_m(M[m] || CC[r..])
+ * Sectors shorter than one block cannot be encrypted and are rejected.
+ * Methods are const, one instance may be shared by threads working on
+ * distinct sectors, see chaskeymt.hpp
+ *
+ * Usage:
+ * 		Xex<Cipher,Formatter> xex;
+ * 		xex.set(key);
+ * 		xex.encrypt(sector, data, 4096);		// one sector in place
+ * 		xex.decrypt(first, data, count, 4096);	// count sectors in place
+ */
+template<class Cipher, class Formatter>
+class Xex {
+public:
+	using Block   = typename Cipher::Block;
+	using item_t  = typename Block::item_t;
+	using block_t = typename Cipher::block_t;
+	using size_t  = typename Formatter::size_t;
+	typedef uint64_t sector_t;
+	inline Xex() noexcept {}
+	inline Xex(const Xex&) = delete; 	/* no copy constructor 				*/
+	explicit inline Xex(const block_t&& _key) noexcept  { set(_key); }
+	explicit inline Xex(const block_t& _key) noexcept { set(_key); }
+
+	/** sets the secret key to use 											*/
+	inline void set(const block_t& _key) noexcept {
+		for(unsigned j = N; j--; ) key[j] = _key[j];
+	}
+	/** true if sectors of size bytes can be processed, i.e. size is zero
+	 *  or at least one block												*/
+	static constexpr bool valid(size_t size) noexcept {
+		return ! size || size >= sizeof(block_t);
+	}
+	/** encrypts in place sector of size bytes, returns false and leaves
+	 *  data unchanged if size is not valid								*/
+	inline bool encrypt(sector_t sector, uint8_t* data, size_t size)
+			const noexcept {
+		return encrypt(sector, data, 1, size);
+	}
+	/** decrypts in place sector of size bytes, returns false and leaves
+	 *  data unchanged if size is not valid								*/
+	inline bool decrypt(sector_t sector, uint8_t* data, size_t size)
+			const noexcept {
+		return decrypt(sector, data, 1, size);
+	}
+	/** encrypts in place count consecutive sectors of size bytes, returns
+	 *  false and leaves data unchanged if size is not valid				*/
+	inline bool encrypt(sector_t first, uint8_t* data, sector_t count,
+			size_t size) const noexcept {
+		if( ! valid(size) ) return false;
+		process<false>(first, data, count, size);
+		return true;
+	}
+	/** decrypts in place count consecutive sectors of size bytes, returns
+	 *  false and leaves data unchanged if size is not valid				*/
+	inline bool decrypt(sector_t first, uint8_t* data, sector_t count,
+			size_t size) const noexcept {
+		if( ! valid(size) ) return false;
+		process<true>(first, data, count, size);
+		return true;
+	}
+protected:
+	static constexpr unsigned run = details::arch_traits::run;
+	static constexpr unsigned N = sizeof(block_t) / sizeof(item_t);
+	/** computes tweaks L of count sectors starting from first, at once	*/
+	inline void tweaks(block_t* l, sector_t first, unsigned count)
+			const noexcept {
+		for(unsigned i = 0; i < count; ++i) {
+			sector_t s = first + i;
+			for(unsigned j = 0; j < N; ++j) {
+				l[i][j] = static_cast<item_t>(s) ^ key[j];
+				s = sizeof(item_t) < sizeof(s) ? s >> (sizeof(item_t) * 8) : 0;
+			}
+		}
+		Cipher::Batch::permute(l, count);
+		for(unsigned i = 0; i < count; ++i)
+			for(unsigned j = N; j--; ) l[i][j] ^= key[j];
+	}
+	template<bool reverse>
+	inline void process(sector_t first, uint8_t* data, sector_t count,
+			size_t size) const noexcept {
+		block_t l[run];
+		while( count ) {
+			unsigned n = count < run ? count : run;
+			tweaks(l, first, n);
+			for(unsigned i = 0; i < n; ++i) {
+				sector<reverse>(l[i], data, size);
+				data += size;
+			}
+			first += n;
+			count -= n;
+		}
+	}
+	/** transforms one sector with tweak l									*/
+	template<bool reverse>
+	inline void sector(const block_t& l, uint8_t* data, size_t size)
+			const noexcept {
+		block_t delta, mask[run], work[run];
+		Cipher::derive(delta, l);
+		const uint_fast8_t tail = size % sizeof(block_t);
+		/* with a tail, the last full block is left for stealing			*/
+		size_t blocks = size / sizeof(block_t) - (tail ? 1 : 0);
+		while( blocks ) {
+			unsigned n = blocks < run ? blocks : run;
+			for(unsigned i = 0; i < n; ++i) {
+				block_t in;
+				Formatter::read(in, data + i * sizeof(block_t));
+				for(unsigned j = N; j--; ) {
+					mask[i][j] = delta[j] ^ key[j];
+					work[i][j] = in[j] ^ mask[i][j];
+				}
+				Cipher::derive(delta, delta);
+			}
+			if( reverse )
+				Cipher::Batch::etumrep(work, n);
+			else
+				Cipher::Batch::permute(work, n);
+			for(unsigned i = 0; i < n; ++i) {
+				for(unsigned j = N; j--; ) work[i][j] ^= mask[i][j];
+				Formatter::final(work[i]);
+				__builtin_memcpy(data + i * sizeof(block_t), work[i],
+					sizeof(block_t));
+			}
+			data   += n * sizeof(block_t);
+			blocks -= n;
+		}
+		if( tail ) steal<reverse>(delta, data, tail);
+	}
+	/**
+	 * transforms with ciphertext stealing the last full block at data,
+	 * with offset delta, and the tail of size bytes following it. The tail
+	 * is swapped with the head of the block between the two transforms.
+	 * Decryption runs the transforms with offsets in reverse order
+	 */
+	template<bool reverse>
+	inline void steal(const block_t& delta, uint8_t* data, uint_fast8_t tail)
+			const noexcept {
+		block_t next;
+		Cipher::derive(next, delta);
+		transform<reverse>(reverse ? next : delta, data);
+		uint8_t* last = data + sizeof(block_t);
+		for(uint_fast8_t i = tail; i--; ) {
+			uint8_t t = data[i];
+			data[i] = last[i];
+			last[i] = t;
+		}
+		transform<reverse>(reverse ? delta : next, data);
+	}
+	/** transforms in place one block at data with offset delta				*/
+	template<bool reverse>
+	inline void transform(const block_t& delta, uint8_t* data)
+			const noexcept {
+		block_t mask, work[1];
+		Formatter::read(work[0], data);
+		for(unsigned j = N; j--; ) {
+			mask[j] = delta[j] ^ key[j];
+			work[0][j] ^= mask[j];
+		}
+		if( reverse )
+			Cipher::Batch::etumrep(work, 1);
+		else
+			Cipher::Batch::permute(work, 1);
+		for(unsigned j = N; j--; ) work[0][j] ^= mask[j];
+		Formatter::final(work[0]);
+		__builtin_memcpy(data, work[0], sizeof(block_t));
+	}
+private:
+	block_t key;
+};
+
+/**
+ * Tree MAC - two-level hash tree for authentication of huge inputs
+ * The message is split in leaves of fixed size, each leaf is signed
+ * independently with Pmac under leaf key 2^3·K, leaf tags are signed in
+ * order with Pmac under node key 2^6·K, together with the final block
+ * {total length, leaf size}. Keys are derived with Cipher::derive, apart
+ * from K, 2·K and 4·K used by Mac.
+ * Leaves may be signed on any number of threads, the tag depends only on
+ * the message, the key and the leaf size, see chaskeymt.hpp
+ *
+ * Usage:
+ * 		Tree<Cipher,Formatter> tree;
+ * 		tree.set(key, leafsize);
+ * 		tree.init(); 							// when reusing instance
+ * 		tree.update(datachunk, false);			// feed data by chunks
+ * 		tree.update(lastdatachunk, true);		// feed last data chunk
+ * 		tree.write(out);						// write computed tag to out
+ * 		tree.verify(tag, taglen);				// or verify tag
+ * or, with leaves signed elsewhere:
+ * 		Tree::sign(tag, tree.leaves(), leaf, leaflen);	// any order
+ * 		tree.append(tag);						// in order of leaves
+ * 		tree.finish(length);
+ */
+template<class Cipher, class Formatter>
+class Tree {
+public:
+	using Block   = typename Cipher::Block;
+	using item_t  = typename Block::item_t;
+	using block_t = typename Cipher::block_t;
+	using size_t  = typename Formatter::size_t;
+	using Leaf    = Pmac<Cipher,Formatter>;
+	using context = typename Leaf::context;
+	typedef uint64_t length_t;
+	static constexpr length_t default_leaf = 65536;
+	inline Tree() noexcept {}
+	inline Tree(const Tree&) = delete; 	/* no copy constructor 				*/
+	explicit inline Tree(const block_t& _key, length_t leaf = default_leaf)
+			noexcept {
+		set(_key, leaf);
+	}
+
+	/** sets the secret key and leaf size, which is rounded down to a
+	 *  multiple of the block size, at least one block					*/
+	inline void set(const block_t& _key, length_t leaf = default_leaf) noexcept {
+		block_t k;
+		Cipher::derive(k, _key);
+		Cipher::derive(k, k);
+		Cipher::derive(k, k);
+		leafmac.set(k);
+		Cipher::derive(k, k);
+		Cipher::derive(k, k);
+		Cipher::derive(k, k);
+		node.set(k);
+		leafsize = leaf < sizeof(block_t) ? sizeof(block_t)
+			: leaf - leaf % sizeof(block_t);
+		init();
+	}
+	/** initializes state for a new message								*/
+	inline void init() noexcept {
+		leafmac.init();
+		node.init();
+		filled = 0;
+		total  = 0;
+	}
+	/** leaf size in bytes													*/
+	inline length_t leaf() const noexcept { return leafsize; }
+	/** key context for signing leaves										*/
+	inline const context& leaves() const noexcept { return leafmac.keys(); }
+	/** processes message chunk msg of length len,
+	 *  final finishes the last leaf and the tree							*/
+	inline void update(const uint8_t* msg, size_t len, bool final) noexcept {
+		while( len ) {
+			size_t n = leafsize - filled < len ? leafsize - filled : len;
+			filled += n;
+			leafmac.update(msg, n, filled == leafsize);
+			if( filled == leafsize ) {
+				append(leafmac.tag());
+				leafmac.init();
+				filled = 0;
+			}
+			total += n;
+			msg   += n;
+			len   -= n;
+		}
+		if( final ) {
+			/* empty message has one empty leaf							*/
+			if( filled || ! total ) {
+				leafmac.update(msg, 0, true);
+				append(leafmac.tag());
+			}
+			finish(total);
+		}
+	}
+	/** computes tag of a leaf, leaves may be signed in any order			*/
+	static inline void sign(block_t& tag, const context& ctx,
+			const uint8_t* msg, size_t len) noexcept {
+		Leaf::sign(tag, ctx, msg, len);
+	}
+	/** appends tag of the next leaf										*/
+	inline void append(const block_t& tag) noexcept {
+		node.update(reinterpret_cast<const uint8_t*>(tag), sizeof(tag), false);
+	}
+	/** finishes the tree of message of length bytes						*/
+	inline void finish(length_t length) noexcept {
+		block_t last = {
+			static_cast<item_t>(length),
+			static_cast<item_t>(length >> 32),
+			static_cast<item_t>(leafsize),
+			static_cast<item_t>(leafsize >> 32) };
+		Formatter::final(last);
+		node.update(reinterpret_cast<const uint8_t*>(last), sizeof(last), true);
+	}
+	/**
+	 * writes computed MAC to output
+	 * if all 16 bytes are not needed, use a stream that trims
+	 */
+	template<class stream>
+	inline void write(stream&& output) const noexcept {
+		node.write(output);
+	}
+	/**
+	 * verifies computed MAC against provided externally tag
+	 */
+	inline bool
+	verify(const void* tag,uint_fast8_t len=sizeof(block_t)) const noexcept {
+		return node.verify(tag, len);
+	}
+private:
+	Leaf leafmac;
+	Leaf node;
+	length_t leafsize;
+	length_t filled;
+	length_t total;
+};
+
+/**
+ * BlockCipher in CLOC Mode https://eprint.iacr.org/2014/157.pdf [157]
+ * In this mode CBC is used to provide both authentication and encryption
+ *
+ * Usage:
+ * 		Cloc<Cipher,Formater> cloc;
+ * 		cloc.set(key);
+ * 		cloc.init(); 							// when reusing instance
+ * 		cloc.update(adchunk, length, false);	// feed AD by chunks
+ * 		cloc.update(lastadchunk, length, true); // feed last AD chunk
+ * 		cloc.nonce(nonce, length);				// feed noce
+ * 		cloc.encrypt(out, datachunk, false);	// feed data by chunks
+ * 		cloc.encrypt(out, lastdatachunk, true);	// feed last data chunk
+ */
+template<class Cipher, class Formatter>
+class Cloc {
+public:
+	using Block   = typename Cipher::Block;
+	using item_t  = typename Block::item_t;
+	using block_t = typename Cipher::block_t;
+	using Pair    = typename Cipher::Pair;
+	using size_t = details::arch_traits::size_t;
+	inline Cloc() noexcept {}
+	inline Cloc(const Cloc&) = delete; 	/* no copy constructor 				*/
+	explicit inline Cloc(const block_t&& _key) noexcept  { set(_key); }
+	explicit inline Cloc(const block_t& _key) noexcept { set(_key); }
+
+	/** sets the secret key to use 											*/
+	inline void set(const block_t& _key) noexcept {
+		key = _key;
+		init();
+	}
+	/**
+	 * Initializes vector by running forward cipher function on nonce
+	 */
+	inline void init() noexcept {
+		enc       = key;
+		ozp       = false;
+		finalized = false;
+		fix0guard = false;
+		g1g2guard = false;
+		nonceguard = false;
+		buff.reset();
+	}
+	/** Processes chunk of associated data msg of length len,
+	 *  final finishes generation by padding the message to the size of
+	 *  block and applying one of derived keys.
+	 *  Corresponds to the first part of HASH, see Fig 3 of [157]			*/
+	inline void update(const uint8_t* msg, size_t len, bool final) noexcept {
+		do {
+			buff.append(msg, len);
+			if( ! len ) {
+				if( ! buff.full() ) {
+					if( final )
+						ozp = buff.pad(0x80);		/* apply ozp 			*/
+					else
+						return;
+				}
+			}
+			bool fixed0 = !fix0guard && fix0(enc);
+			update(buff.block());
+			fix0guard = true;
+			if( fixed0 ) h(enc);
+			buff.reset();
+		} while( len );
+	}
+	/** Processes associated data gathered from count fragments of iov, an
+	 *  array of iovec or of POSIX struct iovec, as if they were one chunk	*/
+	template<typename iovec, typename = details::if_iovec<iovec>>
+	inline void update(const iovec* iov, unsigned count, bool final) noexcept {
+		details::gather(iov, count, final,
+			[this](const uint8_t* msg, size_t len, bool last) {
+				update(msg, len, last); });
+	}
+	/** Processes nonce monce of length len in one chunk
+	 *  Corresponds to the last part of HASH, see Fig 3 of [157]			*/
+	inline void nonce(const uint8_t* monce, size_t len) {
+		/* if buffer is not empty call update for final block				*/
+		if( buff.available() ) update(monce,0,true);
+		if( monce )	buff.append(monce, len);
+		buff.pad(0x80);								/* apply ozp 			*/
+		enc ^= buff.block();
+		if( ozp ) f2(enc);
+		else f1(enc);
+		tag = enc;
+		enc.permute();		/* corresponds to V->EK on fig.4				*/
+		enc ^= key;
+		buff.reset();
+		nonceguard = true;
+	}
+	/**
+	 * Encrypts message msg of length len and writes it to the output stream
+	 * if final == true, the message is padded o the size of block
+	 */
+	template<class stream>
+	inline void encrypt(stream&& output, const uint8_t* msg, size_t len, bool final) noexcept {
+		if( ! nonceguard ) nonce(nullptr,0);
+		do {
+			/* runs of full blocks bypass the formatter					*/
+			if( g1g2guard ) {
+				auto run = buff.runs(msg, len);
+				if( run.count ) {
+					process_runs<false>(output, run.data, run.count);
+					if( ! len ) return;
+				}
+			}
+			uint_fast8_t size;
+			if( ! (size = process(msg, len, final)) ) return;
+			const block_t& result = buff.result(enc);
+			output.write(reinterpret_cast<const char*>(result), size);
+			prf(false, size);
+			buff.reset();
+		} while( len );
+	}
+
+	/**
+	 * Decrypts ciphertext msg of length len and writes it to the output stream
+	 * if final == true, the message is padded o the size of block
+	 */
+	template<class stream>
+	inline void decrypt(stream&& output, const uint8_t* msg, size_t len, bool final) noexcept {
+		Formatter buf;
+		if( ! nonceguard ) nonce(nullptr,0);
+		do {
+			/* runs of full blocks bypass the formatter					*/
+			if( g1g2guard ) {
+				auto run = buff.runs(msg, len);
+				if( run.count ) {
+					process_runs<true>(output, run.data, run.count);
+					if( ! len ) return;
+				}
+			}
+			uint_fast8_t size;
+			if( ! (size = process(msg, len, final)) ) return;
+			/* prf takes the cipher text from msg, when it is accessed
+			 * directly, so plain text is written after, msg may be output	*/
+			Block plain;
+			plain = enc;
+			prf(true, size);
+			const block_t& result = buf.result(plain);
+			output.write(reinterpret_cast<const char*>(result), size);
+			buff.reset();
+		} while( len );
+	}
+	/**
+	 * Encrypts message msg of length len into dst, which may be msg itself,
+	 * returns number of bytes written
+	 */
+	inline size_t encrypt(uint8_t* dst, const uint8_t* msg, size_t len,
+			bool final) noexcept {
+		details::writer output { dst };
+		encrypt(output, msg, len, final);
+		return output.data - dst;
+	}
+	/**
+	 * Decrypts ciphertext msg of length len into dst, which may be msg
+	 * itself, returns number of bytes written
+	 */
+	inline size_t decrypt(uint8_t* dst, const uint8_t* msg, size_t len,
+			bool final) noexcept {
+		details::writer output { dst };
+		decrypt(output, msg, len, final);
+		return output.data - dst;
+	}
+	/**
+	 * Encrypts message gathered from count fragments of iov
+	 */
+	template<class stream, typename iovec, typename = details::if_iovec<iovec>>
+	inline void encrypt(stream&& output, const iovec* iov, unsigned count,
+			bool final) noexcept {
+		details::gather(iov, count, final,
+			[&](const uint8_t* msg, size_t len, bool last) {
+				encrypt(output, msg, len, last); });
+	}
+	/**
+	 * Decrypts ciphertext gathered from count fragments of iov
+	 */
+	template<class stream, typename iovec, typename = details::if_iovec<iovec>>
+	inline void decrypt(stream&& output, const iovec* iov, unsigned count,
+			bool final) noexcept {
+		details::gather(iov, count, final,
+			[&](const uint8_t* msg, size_t len, bool last) {
+				decrypt(output, msg, len, last); });
+	}
+	/**
+	 * writes computed MAC to output
+	 * if all 16 bytes are not needed, use a stream that trims
+	 */
+	template<class stream>
+	void write(stream&& output) const noexcept {
+		finalize();
+		output.write(reinterpret_cast<const char*>(tag.raw()),Cipher::size());
+	}
+	/**
+	 * verifies computed MAC against provided externally tag
+	 */
+	inline bool
+	verify(const void* _tag, uint_fast8_t len=sizeof(block_t)) const noexcept {
+		finalize();
+		return details::equals(tag, _tag,
+			len < sizeof(block_t) ? len : sizeof(block_t));
+	}
+
+	/** one packet of a batch, processed in a single shot					*/
+	struct packet {
+		const block_t* key;
+		const uint8_t* ad;		/* associated data							*/
+		size_t adlen;
+		const uint8_t* nonce;
+		size_t noncelen;
+		const uint8_t* in;		/* plaintext for seal, ciphertext for open	*/
+		uint8_t* out;			/* ciphertext for seal, plaintext for open	*/
+		size_t len;
+		uint8_t* tag;			/* written by seal, verified by open		*/
+	};
+	/**
+	 * encrypts and signs count independent packets, running one packet per
+	 * lane of Kernel, with enc and tag chains of a packet in two kernels.
+	 * Results are same as update(ad, adlen, true), nonce(nonce, noncelen),
+	 * encrypt(out, in, len, true), write(tag) on one Cloc instance
+	 */
+	template<class Kernel>
+	static void seal(const packet* packets, unsigned count) noexcept {
+		batch<Kernel>(packets, count, false,
+			[packets](unsigned i, const block_t& tag) {
+				__builtin_memcpy(packets[i].tag, tag, sizeof(block_t));
+			});
+	}
+	/**
+	 * decrypts and verifies count independent packets,
+	 * sets bit i%32 of mask[i/32] if packet i is verified,
+	 * returns true if all are verified
+	 */
+	template<class Kernel>
+	static bool open(uint32_t* mask, const packet* packets,
+			unsigned count) noexcept {
+		for(unsigned i = (count + 31) / 32; i--; ) mask[i] = 0;
+		unsigned failed = 0;
+		batch<Kernel>(packets, count, true,
+			[mask, packets, &failed](unsigned i, const block_t& tag) {
+				if( details::equals(tag, packets[i].tag, sizeof(block_t)) )
+					mask[i / 32] |= UINT32_C(1) << (i % 32);
+				else
+					++failed;
+			});
+		return failed == 0;
+	}
+
+protected:
+	inline void finalize() const  noexcept {
+		if( ! finalized ) {
+			Formatter::final(tag);
+			finalized = true;
+		}
+	}
+	inline void update(const block_t& input) noexcept {
+		enc  ^= input;
+		enc.permute();
+		enc  ^= key;
+	}
+	inline void cipher() noexcept {
+		tag.permute();
+		tag  ^= key;
+	}
+	inline bool nodata(bool final) noexcept {
+		if( final ) {
+			if( ! g1g2guard && ! buff.available() ) {
+				g1(tag);
+				cipher();
+			} else {
+				buff.pad(0);
+				return false;
+			}
+		}
+		return true;
 	}
 	inline void apply_g2() noexcept {
 		g2(tag);
@@ -498,24 +2133,282 @@ protected:
 	}
 	inline void prf(bool decrypt, uint_fast8_t size) noexcept {
 		if( decrypt ) enc = buff.block();
-		if( size == sizeof(block_t) )
-			tag ^= enc;
-		else
+		if( size != sizeof(block_t) ) {
 			Formatter::xor_bytes(tag.raw(), enc, size);
+			tag ^= key;
+			cipher();
+			return;
+		}
+		/* tag of the cipher text and encryption of the next block depend
+		 * only on the cipher text, both are transformed at once			*/
+		tag ^= enc;
 		tag ^= key;
-		cipher();
-		if( size != sizeof(block_t) ) return;
 		fix1(enc);
 		enc ^= key;
-		enc.permute();
+		Pair pair;
+		pair.load(0, enc);
+		pair.load(1, tag);
+		pair.permute();
+		pair.store(0, enc);
+		pair.store(1, tag);
 		enc ^= key;
+		tag ^= key;
+	}
+	/**
+	 * Processes count full blocks of msg as process and prf do, states are
+	 * kept in local variables, so that the compiler keeps them in registers.
+	 * flatten makes sure Pair rounds are inlined in large translation units
+	 */
+	template<bool decrypt, class stream>
+	__attribute__((flatten))
+	inline void process_runs(stream&& output, const uint8_t* msg, size_t count) noexcept {
+		constexpr unsigned N = sizeof(block_t) / sizeof(item_t);
+		block_t e, t, x;
+		const block_t& k = key;
+		for(unsigned j = N; j--; ) {
+			e[j] = static_cast<const block_t&>(enc)[j];
+			t[j] = static_cast<const block_t&>(tag)[j];
+		}
+		Pair pair;
+		do {
+			Formatter::read(x, msg);
+			for(unsigned j = N; j--; ) e[j] ^= x[j];
+			const block_t& result = buff.result(e);
+			output.write(reinterpret_cast<const char*>(result), sizeof(block_t));
+			/* e is the cipher text from here on							*/
+			if( decrypt ) for(unsigned j = N; j--; ) e[j] = x[j];
+			for(unsigned j = N; j--; ) t[j] ^= e[j] ^ k[j];
+			fix1(e);
+			for(unsigned j = N; j--; ) e[j] ^= k[j];
+			pair.load(0, e);
+			pair.load(1, t);
+			pair.permute();
+			pair.store(0, e);
+			pair.store(1, t);
+			for(unsigned j = N; j--; ) {
+				e[j] ^= k[j];
+				t[j] ^= k[j];
+			}
+			msg += sizeof(block_t);
+		} while( --count );
+		enc = e;
+		tag = t;
+	}
+	/** x = m ? y : x, for each item, m is either all ones or zero		*/
+	template<class B, class M>
+	static inline void select(B& x, const B& y, const M& m) noexcept {
+		for(unsigned i = Block::count; i--; ) x[i] ^= (x[i] ^ y[i]) & m;
+	}
+	/**
+	 * per lane scheduler for seal and open. Each step runs one permutation
+	 * on enc and tag chains of all lanes, a packet takes nA + 1 + nM steps:
+	 * 	AD blocks on enc,
+	 * 	nonce on enc along with g1/g2 on tag,
+	 * 	message blocks on enc along with their ciphertext on tag.
+	 * Tweaks are computed on all lanes and picked with lane masks.
+	 * Kernel must be transposed (Lanes, Swar), i.e. provide fill and [].
+	 * done(i, tag) is called as soon as packet i is completed
+	 */
+	template<class Kernel, class Done>
+	static void batch(const packet* packets, unsigned count, bool decrypt,
+			Done&& done) noexcept {
+		constexpr unsigned L = Kernel::lanes;
+		enum : uint8_t { idle, in_ad, in_nonce, in_data, last };
+		struct {
+			const packet* p;
+			const uint8_t* ad;
+			const uint8_t* in;
+			uint8_t* out;
+			size_t adlen;
+			size_t len;
+			uint_fast8_t size;	/* message bytes in the current step		*/
+			item_t hmask;		/* h pending after the first AD block		*/
+			item_t ozp;			/* AD were OZP padded						*/
+			uint8_t phase;
+		} lane[L];
+		/* lane masks, all ones or zero, except fix1							*/
+		enum : uint8_t { mh, mnonce, mf2, mdata, mg2, mfix1, mnew, mcount };
+		item_t masks[mcount][L];
+		block_t x[L];			/* blocks xored to enc: AD, nonce, message	*/
+		block_t b[L];			/* byte masks of message blocks				*/
+		block_t y[L];			/* enc output, tag output					*/
+		block_t k[L] = {};		/* keys										*/
+		block_t k0[L];			/* keys with fix0 applied					*/
+		Kernel keys {}, enc {}, tag {};
+		unsigned next = 0, busy = 0;
+		for(unsigned l = 0; l < L; ++l) {
+			lane[l].phase = idle;
+			lane[l].hmask = 0;
+		}
+		do {
+			bool hashed = false, nonced = false, data = false, partial = false;
+			bool started = false, finished = false;
+			for(unsigned l = 0; l < L; ++l) {
+				auto& s = lane[l];
+				for(unsigned m = mcount; m--; ) masks[m][l] = 0;
+				masks[mh][l] = s.hmask;
+				hashed |= s.hmask != 0;
+				s.hmask = 0;
+				if( s.phase == idle ) {
+					if( next == count ) {
+						__builtin_memset(x[l], 0, sizeof(block_t));
+						__builtin_memset(b[l], 0, sizeof(block_t));
+						continue;
+					}
+					/* idle lane takes the next packet					*/
+					s.p = packets + next++;
+					s.ad = s.p->ad;
+					s.adlen = s.p->adlen;
+					s.in = s.p->in;
+					s.out = s.p->out;
+					s.len = s.p->len;
+					s.phase = in_ad;
+					__builtin_memcpy(k[l], *s.p->key, sizeof(block_t));
+					__builtin_memcpy(k0[l], *s.p->key, sizeof(block_t));
+					s.hmask = -static_cast<item_t>(fix0(k0[l]));
+					masks[mnew][l] = ~static_cast<item_t>(0);
+					started = true;
+					++busy;
+				}
+				Formatter buff;
+				__builtin_memset(b[l], 0, sizeof(block_t));
+				switch( s.phase ) {
+				case in_ad:
+					if( s.adlen > sizeof(block_t) ) {
+						Formatter::read(x[l], s.ad);
+						s.ad += sizeof(block_t);
+						s.adlen -= sizeof(block_t);
+						break;
+					}
+					buff.append(s.ad, s.adlen);
+					s.ozp = 0;
+					if( ! buff.full() )
+						s.ozp = -static_cast<item_t>(buff.pad(0x80));
+					__builtin_memcpy(x[l], buff.block(), sizeof(block_t));
+					s.phase = in_nonce;
+					break;
+				case in_nonce: {
+					const uint8_t* n = s.p->nonce;
+					size_t len = s.p->noncelen;
+					buff.append(n, len);
+					buff.pad(0x80);
+					__builtin_memcpy(x[l], buff.block(), sizeof(block_t));
+					masks[mnonce][l] = ~static_cast<item_t>(0);
+					masks[mf2][l] = s.ozp;
+					masks[mg2][l] = -static_cast<item_t>(s.len != 0);
+					s.phase = s.len ? in_data : last;
+					finished |= s.phase == last;
+					nonced = true;
+					break;
+				}
+				case in_data: {
+					s.size = s.len < sizeof(block_t) ? s.len : sizeof(block_t);
+					size_t len = s.size;
+					buff.append(s.in, len);
+					if( ! buff.full() ) buff.pad(0);
+					__builtin_memcpy(x[l], buff.block(), sizeof(block_t));
+					/* partial blocks are xored bytewise, as with xor_bytes,
+					 * pad(0) has zeroed the tail of x						*/
+					Formatter::mask(b[l], s.size);
+					partial |= s.size != sizeof(block_t);
+					masks[mdata][l] = ~static_cast<item_t>(0);
+					masks[mfix1][l] = static_cast<item_t>(1) << 31;
+					s.len -= s.size;
+					if( ! s.len ) s.phase = last;
+					finished |= s.phase == last;
+					data = true;
+					break;
+				}
+				default:
+					break;
+				}
+			}
+			Kernel in, m, n;
+			if( started ) {
+				/* enc of lanes taking next packet starts with fix0(key)	*/
+				keys.load(k);
+				in.load(k0);
+				n.fill(2, masks[mnew]);
+				select(enc, in, n[2]);
+			}
+			in.load(x);
+			m.fill(0, masks[mh]);
+			m.fill(1, masks[mnonce]);
+			m.fill(2, masks[mf2]);
+			m.fill(3, masks[mdata]);
+			if( hashed ) {
+				Kernel t = enc;
+				h(t);
+				select(enc, t, m[0]);
+			}
+			enc ^= in;
+			if( nonced ) {
+				n.fill(0, masks[mg2]);
+				Kernel f = enc, t = enc;
+				f1(f);
+				f2(t);
+				select(f, t, m[2]);
+				select(enc, f, m[1]);
+				Kernel g = f;
+				g1(f);
+				g2(g);
+				select(f, g, n[0]);
+				select(tag, f, m[1]);
+			}
+			if( data ) {
+				/* enc holds output, plaintext or ciphertext				*/
+				enc.store(y);
+				if( decrypt ) select(enc, in, m[3]);
+				/* enc holds ciphertext, feeds tag and next key stream		*/
+				if( partial ) {
+					Kernel bytes;
+					bytes.load(b);
+					for(unsigned i = Block::count; i--; )
+						tag[i] ^= (enc[i] & bytes[i]) ^ (keys[i] & m[3]);
+				} else {
+					for(unsigned i = Block::count; i--; )
+						tag[i] ^= (enc[i] ^ keys[i]) & m[3];
+				}
+				n.fill(1, masks[mfix1]);
+				enc[0] |= n[1];
+				for(unsigned i = Block::count; i--; ) enc[i] ^= keys[i] & m[3];
+			}
+			enc.permute();
+			enc ^= keys;
+			if( nonced || data ) {
+				tag.permute();
+				tag ^= keys;
+			}
+			for(unsigned l = 0; data && l < L; ++l) {
+				auto& s = lane[l];
+				if( ! masks[mdata][l] ) continue;
+				Formatter out;
+				const uint8_t* r =
+					reinterpret_cast<const uint8_t*>(out.result(y[l]));
+				if( s.size == sizeof(block_t) )
+					__builtin_memcpy(s.out, r, sizeof(block_t));
+				else
+					for(uint_fast8_t j = s.size; j--; ) s.out[j] = r[j];
+				s.out += s.size;
+			}
+			if( finished ) tag.store(y);
+			for(unsigned l = 0; finished && l < L; ++l) {
+				auto& s = lane[l];
+				if( s.phase != last ) continue;
+				Formatter::final(y[l]);
+				done(s.p - packets, y[l]);
+				s.phase = idle;
+				--busy;
+			}
+		} while( busy || next < count );
 	}
 private:
 	/* CLOC-specific tweak function, chapter 3, [157]						*/
 	/* Courtesy to Markku-Juhani O. Saarinen (mjosaarinen)					*/
 	/* https://github.com/mjosaarinen/brutus/tree/master/crypto_aead_round1/aes128n12clocv1/ref */
 	/** f1(X) = (X[1, 3],X[2, 4],X[1, 2, 3],X[2, 3, 4])						*/
-	static inline void f1(block_t& b) noexcept {
+	template<class B>
+	static inline void f1(B& b) noexcept {
 		b[0]  ^= b[2];			/* X[1, 3]									*/
 		auto t = b[1];
 		b[1]  ^= b[3];			/* X[2, 4]									*/
@@ -523,7 +2416,8 @@ private:
 		b[2]   = b[0] ^ t;		/* X[1, 2, 3]								*/
 	}
 	/** f2(X) = (X[2],X[3],X[4],X[1, 2])									*/
-	static inline void f2(block_t& b) noexcept {
+	template<class B>
+	static inline void f2(B& b) noexcept {
 		auto t = b[0] ^ b[1];
 		b[0]   = b[1];			/* X[2]										*/
 		b[1]   = b[2];			/* X[2]										*/
@@ -531,7 +2425,8 @@ private:
 		b[3]   = t;				/* X[1, 2]									*/
 	}
 	/** g1(X) = (X[3],X[4],X[1, 2],X[2, 3])									*/
-	static inline void g1(block_t& b) noexcept {
+	template<class B>
+	static inline void g1(B& b) noexcept {
 		auto t = b[0];
 		b[0]   = b[2];			/* X[3]										*/
 		b[2]   = b[1] ^ t;		/* X[1, 2]									*/
@@ -540,9 +2435,11 @@ private:
 		b[3]   = b[0] ^ t;		/* X[2, 3]									*/
 	}
 	/** g2(X) = (X[2],X[3],X[4],X[1, 2])									*/
-	static inline void g2(block_t& b) noexcept { f2(b); }
+	template<class B>
+	static inline void g2(B& b) noexcept { f2(b); }
 	/** h(X) = (X[1, 2],X[2, 3],X[3, 4],X[1, 2, 4]) 						*/
-	static inline void h(block_t& b) noexcept {
+	template<class B>
+	static inline void h(B& b) noexcept {
 		b[0] ^= b[1]; 			/* X[1, 2]									*/
 		b[1] ^= b[2];			/* X[2, 3]									*/
 		b[2] ^= b[3];			/* X[3, 4]									*/
@@ -569,21 +2466,69 @@ private:
 	mutable bool finalized;	/* tag has been reordered as little endian		*/
 };
 
+/**
+ * BlockCipher in Authentication Mode, signing one message under many keys
+ * Message blocks are read once per Kernel::lanes keys and xored to all
+ * lanes at once, padding and choice of the final key are done once,
+ * since the message length is the same for all keys.
+ * Tags are same as computed by Mac<Cipher,Formatter> with each key
+ *
+ * Usage:
+ * 		Broadcast<Cipher,Kernel,Formatter>::context keys[K];
+ * 		keys[i].set(key);						// once per key
+ * 		Broadcast<Cipher,Kernel,Formatter>::sign(tags, keys, K, msg, len);
+ */
+template<class Cipher, class Kernel, class Formatter>
+class Broadcast {
+public:
+	using block_t = typename Cipher::block_t;
+	using size_t = typename Formatter::size_t;
+	/** key context, same as kept in Mac									*/
+	using context = typename Mac<Cipher,Formatter>::context;
+	/** computes count tags of message msg of length len with count keys	*/
+	static void sign(block_t* tags, const context* keys, unsigned count,
+			const uint8_t* msg, size_t len) noexcept {
+		/* all full blocks but the last one are read directly			*/
+		size_t body = len ? (len - 1) / sizeof(block_t) * sizeof(block_t) : 0;
+		const uint8_t* tail = msg + body;
+		len -= body;
+		Formatter buff;
+		buff.append(tail, len);
+		bool padded = ! buff.full();
+		if( padded ) buff.pad(1);
+		while( count ) {
+			unsigned n = count < Kernel::lanes ? count : Kernel::lanes;
+			Kernel state {}, finalkey {};
+			/* unused lanes run on copies of the first key					*/
+			for(unsigned l = Kernel::lanes; l--; ) {
+				const context& k = keys[l < n ? l : 0];
+				state.load(l, k.key);
+				finalkey.load(l, padded ? k.subkey2 : k.subkey1);
+			}
+			block_t input;
+			for(const uint8_t* p = msg; p != msg + body; p += sizeof(block_t)) {
+				Formatter::read(input, p);
+				state ^= input;
+				state.permute();
+			}
+			state ^= buff.block();
+			state ^= finalkey;
+			state.permute();
+			state ^= finalkey;
+			for(unsigned l = 0; l < n; ++l) {
+				state.store(l, tags[l]);
+				Formatter::final(tags[l]);
+			}
+			keys  += n;
+			tags  += n;
+			count -= n;
+		}
+	}
+};
+
 
 namespace details {
 
-struct arch_traits {
-	/* free standing constexpr not yet available,
-	 * therefore it has to be placed inside  a struct 						*/
-	static bool constexpr big_endian = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
-#	ifdef __xtensa__
-	/* unaligned access to uint32_t causes system fault on esp8266			 */
-	static bool constexpr direct_safe = false;
-#	else
-	static bool constexpr direct_safe = ! big_endian;
-#endif
-};
-
 /**
  * Rotate right operation
  * gcc compiler generates
@@ -605,6 +2550,93 @@ static inline constexpr T rol(T x, uint_fast8_t N) {
 	return (x >> (sizeof(T)*8 - N)) | ((x) << (N));
 }
 
+/**
+ * Vector of L items of type T
+ * gcc maps it on SSE2/AVX2/NEON registers when available
+ * or splits it into scalar operations otherwise
+ */
+template<typename T, unsigned L>
+struct vector {
+	typedef T type __attribute__((vector_size(sizeof(T)*L)));
+};
+
+/**
+ * Lane-wise operations on vector<T,L>
+ * Generic version relies solely on gcc vector extensions,
+ * specializations may use target-specific intrinsics
+ */
+template<typename T, unsigned L>
+struct lane_ops {
+	typedef typename vector<T,L>::type lane_t;
+	/* vectors are passed by reference to avoid ABI issues on wide types	*/
+	template<uint_fast8_t S>
+	static inline void rol(lane_t& x) noexcept {
+		x = (x >> (sizeof(T)*8 - S)) | (x << S);
+	}
+	template<uint_fast8_t S>
+	static inline void ror(lane_t& x) noexcept {
+		x = (x << (sizeof(T)*8 - S)) | (x >> S);
+	}
+};
+
+#ifdef __AVX512F__
+/**
+ * AVX-512 lane operations, each 32-bit rotate is a single VPROLD/VPRORD
+ * Not a lane_ops specialization: translation units built without AVX-512
+ * instantiate lane_ops<uint32_t,16> too and the two must not be merged
+ */
+struct avx512_ops {
+	typedef vector<uint32_t,16>::type lane_t;
+	template<uint_fast8_t S>
+	static inline void rol(lane_t& x) noexcept {
+		x = (lane_t) _mm512_rol_epi32((__m512i) x, S);
+	}
+	template<uint_fast8_t S>
+	static inline void ror(lane_t& x) noexcept {
+		x = (lane_t) _mm512_ror_epi32((__m512i) x, S);
+	}
+};
+#endif
+
+#ifdef __ARM_NEON
+/**
+ * NEON lane operations, rotates are VSHL+VSRA pairs,
+ * 16-bit rotates are done with a single VREV32.16
+ */
+template<>
+struct lane_ops<uint32_t,4> {
+	typedef vector<uint32_t,4>::type lane_t;
+	template<uint_fast8_t S>
+	static inline void rol(lane_t& x) noexcept {
+		uint32x4_t t = (uint32x4_t) x;
+		if( S == 16 )
+			t = vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(t)));
+		else
+			t = vsraq_n_u32(vshlq_n_u32(t, S), t, 32 - S);
+		x = (lane_t) t;
+	}
+	template<uint_fast8_t S>
+	static inline void ror(lane_t& x) noexcept {
+		rol<32 - S>(x);
+	}
+};
+#endif
+
+/**
+ * Selects lane operations for the target the translation unit is built for
+ */
+template<typename T, unsigned L>
+struct native_ops {
+	typedef lane_ops<T,L> type;
+};
+
+#ifdef __AVX512F__
+template<>
+struct native_ops<uint32_t,16> {
+	typedef avx512_ops type;
+};
+#endif
+
 /**
  * Handles byte order
  */
@@ -642,14 +2674,32 @@ inline uint32_t endian<true>::byteswap(uint32_t val) noexcept {
 template<typename T, unsigned N>
 class simple_formatter {
 public:
-	typedef uint_fast16_t size_t; /* not expecting chunks larger 64K  */
+	typedef arch_traits::size_t size_t;
 	typedef T block_t[N];
 	inline void append(const uint8_t*& msg, size_t& len) noexcept {
+		if( ! arch_traits::big_endian ) {
+			/* bytes are in place, the fragment is copied at once			*/
+			size_t n = sizeof(data.b) - pos < len ? sizeof(data.b) - pos : len;
+			__builtin_memcpy(data.b + pos, msg, n);
+			pos += n;
+			msg += n;
+			len -= n;
+			return;
+		}
 		while( pos < sizeof(data.b) && len ) {
 			data.b[endian<>::index<sizeof(T)>(pos++)] = *msg++;
 			--len;
 		}
 	}
+	/** reads one full block from msg as little-endian items				*/
+	static inline void read(block_t& block, const uint8_t* msg) noexcept {
+		for(uint_fast8_t i = 0; i < N; ++i) {
+			T item = 0;
+			for(uint_fast8_t b = sizeof(T); b--; )
+				item = (item << 8) | msg[i * sizeof(T) + b];
+			block[i] = item;
+		}
+	}
 	inline size_t append(const block_t& block) noexcept {
 		const uint8_t* msg = reinterpret_cast<const uint8_t*>(block);
 		size_t len = sizeof(block_t);
@@ -671,6 +2721,25 @@ public:
 	inline bool full() const noexcept {
 		return available() == sizeof(data.b);
 	}
+	/** contiguous full blocks of the input, each is taken with read()		*/
+	struct run_t {
+		const uint8_t* data;
+		size_t count;
+	};
+	/**
+	 * takes from msg the run of full blocks that bypass the buffer, only
+	 * if the buffer is empty, and advances msg and len past the run, so that
+	 * only head and tail fragments are appended. If hold is true, at least
+	 * one byte is left to append, i.e. the last full block is not taken
+	 */
+	inline run_t runs(const uint8_t*& msg, size_t& len, bool hold = false)
+			noexcept {
+		run_t run { msg, 0 };
+		if( ! pos && len ) run.count = (hold ? len - 1 : len) / sizeof(block_t);
+		msg += run.count * sizeof(block_t);
+		len -= run.count * sizeof(block_t);
+		return run;
+	}
 	inline void reset() noexcept {
 		pos = 0;
 	}
@@ -706,7 +2775,13 @@ public:
 			++i;
 		}
 	}
-private:
+	/** sets block to the mask of the bytes, that xor_bytes takes for len	*/
+	inline static void mask(block_t& block, uint_fast8_t len) noexcept {
+		uint8_t* bytes = reinterpret_cast<uint8_t*>(block);
+		for(uint_fast8_t i = 0; i < sizeof(block_t); ++i)
+			bytes[details::endian<>::index<4>(i)] = i < len ? 0xFF : 0;
+	}
+protected:
 	/* union is used to get proper alignment on data						*/
 	union {
 		block_t w;
@@ -722,15 +2797,47 @@ private:
  * 1. last block of shorter length stored and padded in the buffer
  * 2. on big-endian machines data must be reordered
  * 3. if an integer cannot be accessed via unaligned pointer
+ * If aligned is true, the last case is decided at run time, per block
  */
-template<typename T, unsigned N, bool direct = arch_traits::direct_safe>
+template<typename T, unsigned N, bool direct = arch_traits::direct_safe,
+	bool aligned = arch_traits::aligned_safe>
 class block_formatter;
 
+/**
+ * Buffered formatter for targets, where items cannot be accessed directly,
+ * such as big-endian. Full blocks are loaded a word at a time, with
+ * __builtin_memcpy, which does not assume alignment, and a byteswap, that
+ * compilers map on single instructions (wsbh/rotr on MIPS32r2, rev on ARM).
+ * Only head and tail fragments are appended byte by byte
+ */
 template<typename T, unsigned N>
-class block_formatter<T,N,false> : public simple_formatter<T,N> {};
+class block_formatter<T,N,false,false> : public simple_formatter<T,N> {
+public:
+	typedef simple_formatter<T,N> base;
+	using typename base::block_t;
+	using typename base::size_t;
+	inline void append(const uint8_t*& msg, size_t& len) noexcept {
+		if( len < sizeof(block_t) || base::pos ) {
+			base::append(msg, len);
+		} else {
+			read(base::data.w, msg);
+			base::pos = sizeof(block_t);
+			msg += sizeof(block_t);
+			len -= sizeof(block_t);
+		}
+	}
+	/** reads one full block from msg as little-endian items, word-wise		*/
+	static inline void read(block_t& block, const uint8_t* msg) noexcept {
+		for(uint_fast8_t i = 0; i < N; ++i) {
+			T item;
+			__builtin_memcpy(&item, msg + i * sizeof(T), sizeof(T));
+			block[i] = endian<>::byteswap<T>(item);
+		}
+	}
+};
 
-template<typename T, unsigned N>
-class block_formatter<T,N,true> : public simple_formatter<T,N> {
+template<typename T, unsigned N, bool aligned>
+class block_formatter<T,N,true,aligned> : public simple_formatter<T,N> {
 public:
 	typedef simple_formatter<T,N> base;
 	using typename base::block_t;
@@ -750,6 +2857,11 @@ public:
 	inline const block_t& block() const noexcept {
 		return *raw;
 	}
+	/** reads one full block from msg directly								*/
+	static inline void read(block_t& block, const uint8_t* msg) noexcept {
+		const block_t& raw = *reinterpret_cast<const block_t*>(msg);
+		for(uint_fast8_t i = N; i--; ) block[i] = raw[i];
+	}
 	inline void reset() noexcept {
 		base::reset();
 		raw = &base::block();
@@ -761,16 +2873,65 @@ public:
 	inline bool full() const noexcept {
 		return available() == sizeof(block_t);
 	}
+	/** same as base::runs, nothing is taken while a block is referenced	*/
+	inline typename base::run_t
+	runs(const uint8_t*& msg, size_t& len, bool hold = false) noexcept {
+		if( size ) return { msg, 0 };
+		return base::runs(msg, len, hold);
+	}
 	static inline void
 	xor_bytes(uint8_t* state, const void* ptr, uint_fast8_t len) noexcept {
 		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(ptr);
 		while(len--) *state++ ^= *bytes++;
 	}
-private:
+	/** sets block to the mask of the bytes, that xor_bytes takes for len	*/
+	inline static void mask(block_t& block, uint_fast8_t len) noexcept {
+		uint8_t* bytes = reinterpret_cast<uint8_t*>(block);
+		for(uint_fast8_t i = 0; i < sizeof(block_t); ++i)
+			bytes[i] = i < len ? 0xFF : 0;
+	}
+protected:
 	const block_t* raw = nullptr;
 	uint_fast8_t size = 0;
 };
 
+/**
+ * Formatter for little-endian targets with strict alignment, such as
+ * esp8266. The alignment of the input is checked at run time, aligned
+ * blocks are accessed directly, misaligned ones are assembled from bytes
+ * into the buffer one item at a time
+ */
+template<typename T, unsigned N>
+class block_formatter<T,N,false,true> : public block_formatter<T,N,true> {
+public:
+	typedef block_formatter<T,N,true> base;
+	typedef simple_formatter<T,N> buffer;
+	using typename base::block_t;
+	using typename base::size_t;
+	inline void append(const uint8_t*& msg, size_t& len) noexcept {
+		if( len < sizeof(block_t) || base::available() || aligned(msg) ) {
+			base::append(msg, len);
+		} else {
+			buffer::read(buffer::data.w, msg);
+			buffer::pos = sizeof(block_t);
+			base::raw = &buffer::block();
+			base::size = 0;
+			msg += sizeof(block_t);
+			len -= sizeof(block_t);
+		}
+	}
+	/** reads one full block from msg, directly if it is aligned			*/
+	static inline void read(block_t& block, const uint8_t* msg) noexcept {
+		if( aligned(msg) )
+			base::read(block, msg);
+		else
+			buffer::read(block, msg);
+	}
+	static inline bool aligned(const uint8_t* msg) noexcept {
+		return ! (reinterpret_cast<uintptr_t>(msg) & (alignof(T) - 1));
+	}
+};
+
 /**
  * Block of bits stored as of N elements of type T
  */
@@ -843,10 +3004,100 @@ protected:
 		for(auto i = N; i--; ) v[i] = val[i];
 	}
 };
+
+/**
+ * batch - applies Kernel's permutations to a number of independent blocks
+ * Kernel must implement Lanes-alike interface:
+ * 1. lanes                             - number of states processed at once
+ * 2. void load(const block_t*);        - loads states from lanes blocks
+ * 3. void store(block_t*);             - stores states to lanes blocks
+ * 4. void permute(); void etumrep();   - transforms all states
+ */
+template<class Kernel>
+struct batch {
+	typedef typename Kernel::block_t block_t;
+	static constexpr unsigned lanes = Kernel::lanes;
+	/** transforms count blocks in-place with forward transformation		*/
+	static inline void permute(block_t* blocks, unsigned count) noexcept {
+		Kernel kernel;
+		for(; count >= lanes; count -= lanes, blocks += lanes) {
+			kernel.load(blocks);
+			kernel.permute();
+			kernel.store(blocks);
+		}
+		if( count ) tail<&Kernel::permute>(kernel, blocks, count);
+	}
+	/** transforms count blocks in-place with reverse transformation		*/
+	static inline void etumrep(block_t* blocks, unsigned count) noexcept {
+		Kernel kernel;
+		for(; count >= lanes; count -= lanes, blocks += lanes) {
+			kernel.load(blocks);
+			kernel.etumrep();
+			kernel.store(blocks);
+		}
+		if( count ) tail<&Kernel::etumrep>(kernel, blocks, count);
+	}
+private:
+	/* incomplete group is processed via a zero-filled buffer				*/
+	template<void (Kernel::*transform)()>
+	static inline void tail(Kernel& kernel, block_t* blocks, unsigned count)
+			noexcept {
+		block_t tmp[lanes] = {};
+		for(unsigned l = lanes; l--; ) if( l < count )
+			for(unsigned i = Kernel::count; i--; ) tmp[l][i] = blocks[l][i];
+		kernel.load(tmp);
+		(kernel.*transform)();
+		kernel.store(tmp);
+		for(unsigned l = lanes; l--; ) if( l < count )
+			for(unsigned i = Kernel::count; i--; ) blocks[l][i] = tmp[l][i];
+	}
+};
 }
 
 namespace chaskey {
 
+template<unsigned N, unsigned L,
+	class Ops = typename details::native_ops<uint32_t,L>::type>
+class Lanes;
+
+template<unsigned N, unsigned K>
+class Interleaved;
+
+/**
+ * kernel - selects default batch kernel: Lanes where SIMD is available,
+ * otherwise Interleaved scalar states
+ */
+template<unsigned N, bool = details::arch_traits::simd>
+struct kernel;
+
+template<unsigned N>
+struct kernel<N,true> {
+	typedef Lanes<N,details::arch_traits::lanes> type;
+};
+
+/* two states fit in registers of most 32-bit cores, including ARM		*/
+template<unsigned N>
+struct kernel<N,false> {
+	typedef Interleaved<N,2> type;
+};
+
+template<unsigned N, unsigned K>
+class Sequential;
+
+/**
+ * pair - selects two states transformed in lock-step: Interleaved, or
+ * Sequential on narrow cores, where interleaving only adds spills
+ */
+template<unsigned N, bool = details::arch_traits::narrow>
+struct pair {
+	typedef Interleaved<N,2> type;
+};
+
+template<unsigned N>
+struct pair<N,true> {
+	typedef Sequential<N,2> type;
+};
+
 /**
  * Cipher - block of 128 bits with N-round permutation
  */
@@ -859,6 +3110,22 @@ public:
 	using Cbc = crypto::Cbc<Cipher,details::block_formatter<item_t,count>>;
 	using Mac = crypto::Mac<Cipher,details::block_formatter<item_t,count>>;
 	using Cloc= crypto::Cloc<Cipher,details::block_formatter<item_t,count>>;
+	using Ctr = crypto::Ctr<Cipher,details::block_formatter<item_t,count>>;
+	using Pmac= crypto::Pmac<Cipher,details::block_formatter<item_t,count>>;
+	using Eax = crypto::Eax<Cipher,details::block_formatter<item_t,count>>;
+	using Xex = crypto::Xex<Cipher,details::block_formatter<item_t,count>>;
+	using Tree= crypto::Tree<Cipher,details::block_formatter<item_t,count>>;
+	using Etm = crypto::Etm<Cipher,details::block_formatter<item_t,count>>;
+	template<unsigned L = details::arch_traits::lanes>
+	using Lanes = chaskey::Lanes<N,L>;
+	/* default multi-lane kernel, e.g. for Mac::sign<Kernel>				*/
+	using Kernel = typename kernel<N>::type;
+	/* batch entry points: Batch::permute(blocks, count) and etumrep		*/
+	using Batch = details::batch<Kernel>;
+	/* two states in lock-step, for modes running two chains side by side	*/
+	using Pair = typename pair<N>::type;
+	using Broadcast = crypto::Broadcast<Cipher, Kernel,
+		details::block_formatter<item_t,count>>;
 
 	using base::operator=;
 	using base::operator==;
@@ -938,6 +3205,400 @@ protected:
 	}
 };
 
+/**
+ * Lanes - L independent Chaskey states with N-round permutation
+ * States are stored transposed, v[i] holds i-th item of all states,
+ * so that each round is computed on all L states at once
+ */
+template<unsigned N, unsigned L, class Ops>
+class Lanes {
+public:
+	typedef details::block<uint32_t, 4> Block;
+	typedef Block::item_t item_t;
+	typedef Block::block_t block_t;
+	typedef typename Ops::lane_t lane_t;
+	static constexpr unsigned count = Block::count;	/* == 4				*/
+	static constexpr unsigned lanes = L;
+
+	/** loads L blocks, one per lane										*/
+	inline void load(const block_t* in) noexcept {
+		/* L blocks occupy four vectors, transposed them in two passes
+		 * of picking even and odd items									*/
+		lane_t r[count], a[count];
+		__builtin_memcpy(r, in, sizeof(r));
+		unzip(a[0], r[0], r[1], 0);
+		unzip(a[1], r[0], r[1], 1);
+		unzip(a[2], r[2], r[3], 0);
+		unzip(a[3], r[2], r[3], 1);
+		unzip(v[0], a[0], a[2], 0);
+		unzip(v[2], a[0], a[2], 1);
+		unzip(v[1], a[1], a[3], 0);
+		unzip(v[3], a[1], a[3], 1);
+	}
+	/** stores all lanes to L blocks										*/
+	inline void store(block_t* out) const noexcept {
+		lane_t r[count], a[count];
+		zip(a[0], v[0], v[2], 0);
+		zip(a[2], v[0], v[2], L/2);
+		zip(a[1], v[1], v[3], 0);
+		zip(a[3], v[1], v[3], L/2);
+		zip(r[0], a[0], a[1], 0);
+		zip(r[1], a[0], a[1], L/2);
+		zip(r[2], a[2], a[3], 0);
+		zip(r[3], a[2], a[3], L/2);
+		__builtin_memcpy(out, r, sizeof(r));
+	}
+	/** loads one block to lane l											*/
+	inline void load(unsigned l, const block_t& in) noexcept {
+		for(unsigned i = count; i--; ) v[i][l] = in[i];
+	}
+	/** stores lane l to one block											*/
+	inline void store(unsigned l, block_t& out) const noexcept {
+		for(unsigned i = count; i--; ) out[i] = v[i][l];
+	}
+	inline void operator^=(const Lanes& val) noexcept {
+		for(unsigned i = count; i--; ) v[i] ^= val.v[i];
+	}
+	/** xors same block to all lanes										*/
+	inline void operator^=(const block_t& val) noexcept {
+		for(unsigned i = count; i--; ) v[i] ^= val[i];
+	}
+	/** fills i-th item of all lanes from L items							*/
+	inline void fill(unsigned i, const item_t* in) noexcept {
+		__builtin_memcpy(&v[i], in, sizeof(lane_t));
+	}
+	/** i-th item of all lanes												*/
+	inline lane_t& operator[](unsigned i) noexcept { return v[i]; }
+	inline const lane_t& operator[](unsigned i) const noexcept { return v[i]; }
+	/**
+	 * Chaskey transformation on all lanes
+	 */
+	inline void permute() noexcept {
+		/* compiler effectively unrolls this loop if optimizes for speed */
+		for(auto i=N; i--;) round();
+	}
+	/**
+	 * Chaskey reverse transformation on all lanes
+	 */
+	inline void etumrep() noexcept {
+		/* compiler effectively unrolls this loop if optimizes for speed */
+		for(auto i=N; i--;) dnour();
+	}
+protected:
+	/**
+	 * Chaskey round, same as Cipher<N>::round
+	 */
+	inline void round() noexcept {
+		v[0] += v[1];
+		Ops::template rol< 5>(v[1]);
+		v[1] ^= v[0];
+		Ops::template rol<16>(v[0]);
+		v[2] += v[3];
+		Ops::template rol< 8>(v[3]);
+		v[3] ^= v[2];
+		v[0] += v[3];
+		Ops::template rol<13>(v[3]);
+		v[3] ^= v[0];
+		v[2] += v[1];
+		Ops::template rol< 7>(v[1]);
+		v[1] ^= v[2];
+		Ops::template rol<16>(v[2]);
+	}
+	/**
+	 * Chaskey reverse round, same as Cipher<N>::dnour
+	 */
+	inline void dnour() noexcept {
+		Ops::template ror<16>(v[2]);
+		v[1] ^= v[2];
+		Ops::template ror< 7>(v[1]);
+		v[2] -= v[1];
+		v[3] ^= v[0];
+		Ops::template ror<13>(v[3]);
+		v[0] -= v[3];
+		v[3] ^= v[2];
+		Ops::template ror< 8>(v[3]);
+		v[2] -= v[3];
+		Ops::template ror<16>(v[0]);
+		v[1] ^= v[0];
+		Ops::template ror< 5>(v[1]);
+		v[0] -= v[1];
+	}
+	typedef typename details::vector<int32_t, L>::type mask_t;
+	/* picks even (first=0) or odd (first=1) items of concatenated a and b	*/
+	static inline void
+	unzip(lane_t& out, const lane_t& a, const lane_t& b, unsigned first) noexcept {
+		mask_t m;
+		for(unsigned j = 0; j < L; ++j) m[j] = first + 2 * j;
+		out = __builtin_shuffle(a, b, m);
+	}
+	/* interleaves lower (first=0) or upper (first=L/2) halves of a and b	*/
+	static inline void
+	zip(lane_t& out, const lane_t& a, const lane_t& b, unsigned first) noexcept {
+		mask_t m;
+		for(unsigned j = 0; j < L; ++j) m[j] = first + j / 2 + (j & 1) * L;
+		out = __builtin_shuffle(a, b, m);
+	}
+	lane_t v[count];
+};
+
+/**
+ * Interleaved - K independent Chaskey states with N-round permutation
+ * for targets without SIMD. States are advanced in lock-step, so that
+ * the compiler may interleave K independent dependency chains
+ */
+template<unsigned N, unsigned K>
+class Interleaved {
+public:
+	typedef details::block<uint32_t, 4> Block;
+	typedef Block::item_t item_t;
+	typedef Block::block_t block_t;
+	static constexpr unsigned count = Block::count;	/* == 4				*/
+	static constexpr unsigned lanes = K;
+
+	/** loads K blocks, one per state										*/
+	inline void load(const block_t* in) noexcept {
+		for(unsigned k = K; k--; ) load(k, in[k]);
+	}
+	/** stores all states to K blocks										*/
+	inline void store(block_t* out) const noexcept {
+		for(unsigned k = K; k--; ) store(k, out[k]);
+	}
+	/** loads one block to state k											*/
+	inline void load(unsigned k, const block_t& in) noexcept {
+		for(unsigned i = count; i--; ) v[k][i] = in[i];
+	}
+	/** stores state k to one block											*/
+	inline void store(unsigned k, block_t& out) const noexcept {
+		for(unsigned i = count; i--; ) out[i] = v[k][i];
+	}
+	inline void operator^=(const Interleaved& val) noexcept {
+		for(unsigned k = K; k--; )
+			for(unsigned i = count; i--; ) v[k][i] ^= val.v[k][i];
+	}
+	/** xors same block to all states										*/
+	inline void operator^=(const block_t& val) noexcept {
+		for(unsigned k = K; k--; )
+			for(unsigned i = count; i--; ) v[k][i] ^= val[i];
+	}
+	/**
+	 * Chaskey transformation on all states
+	 */
+	inline void permute() noexcept {
+		/* compiler effectively unrolls this loop if optimizes for speed */
+		for(auto i=N; i--;) round();
+	}
+	/**
+	 * Chaskey reverse transformation on all states
+	 */
+	inline void etumrep() noexcept {
+		/* compiler effectively unrolls this loop if optimizes for speed */
+		for(auto i=N; i--;) dnour();
+	}
+protected:
+	/**
+	 * Chaskey round, same as Cipher<N>::round with independent operations
+	 * grouped into four steps, each step is done on all states
+	 */
+	inline void round() noexcept {
+		using namespace details;
+		for(unsigned k = 0; k < K; ++k) {
+			v[k][0] += v[k][1];
+			v[k][2] += v[k][3];
+		}
+		for(unsigned k = 0; k < K; ++k) {
+			v[k][1]  = rol<item_t>(v[k][1], 5) ^ v[k][0];
+			v[k][3]  = rol<item_t>(v[k][3], 8) ^ v[k][2];
+			v[k][0]  = rol<item_t>(v[k][0],16);
+		}
+		for(unsigned k = 0; k < K; ++k) {
+			v[k][0] += v[k][3];
+			v[k][2] += v[k][1];
+		}
+		for(unsigned k = 0; k < K; ++k) {
+			v[k][3]  = rol<item_t>(v[k][3],13) ^ v[k][0];
+			v[k][1]  = rol<item_t>(v[k][1], 7) ^ v[k][2];
+			v[k][2]  = rol<item_t>(v[k][2],16);
+		}
+	}
+	/**
+	 * Chaskey reverse round, same as Cipher<N>::dnour
+	 */
+	inline void dnour() noexcept {
+		using namespace details;
+		for(unsigned k = 0; k < K; ++k) {
+			v[k][2]  = ror<item_t>(v[k][2],16);
+			v[k][1]  = ror<item_t>(v[k][1] ^ v[k][2], 7);
+			v[k][3]  = ror<item_t>(v[k][3] ^ v[k][0],13);
+		}
+		for(unsigned k = 0; k < K; ++k) {
+			v[k][2] -= v[k][1];
+			v[k][0] -= v[k][3];
+		}
+		for(unsigned k = 0; k < K; ++k) {
+			v[k][3]  = ror<item_t>(v[k][3] ^ v[k][2], 8);
+			v[k][0]  = ror<item_t>(v[k][0],16);
+			v[k][1]  = ror<item_t>(v[k][1] ^ v[k][0], 5);
+		}
+		for(unsigned k = 0; k < K; ++k) {
+			v[k][2] -= v[k][3];
+			v[k][0] -= v[k][1];
+		}
+	}
+	block_t v[K];
+};
+
+/**
+ * Sequential - K independent Chaskey states with N-round permutation,
+ * transformed one after another. Same interface as Interleaved
+ */
+template<unsigned N, unsigned K>
+class Sequential : public Interleaved<N,K> {
+public:
+	inline void permute() noexcept {
+		for(unsigned k = 0; k < K; ++k) {
+			Cipher<N> state;
+			state = this->v[k];
+			state.permute();
+			this->load(k, state);
+		}
+	}
+	inline void etumrep() noexcept {
+		for(unsigned k = 0; k < K; ++k) {
+			Cipher<N> state;
+			state = this->v[k];
+			state.etumrep();
+			this->load(k, state);
+		}
+	}
+};
+
+/**
+ * Swar - two independent Chaskey states with N-round permutation packed
+ * into 64-bit words (SIMD within a register) for 64-bit cores without SIMD
+ * v[i] holds i-th item of state 0 in the lower and of state 1 in the upper
+ * half. Carries are masked at the lanes boundary on additions and
+ * subtractions, rotates are done with masked shifts
+ */
+template<unsigned N>
+class Swar {
+public:
+	typedef details::block<uint32_t, 4> Block;
+	typedef Block::item_t item_t;
+	typedef Block::block_t block_t;
+	typedef uint64_t word_t;
+	static constexpr unsigned count = Block::count;	/* == 4				*/
+	static constexpr unsigned lanes = 2;
+
+	/** loads two blocks, one per lane										*/
+	inline void load(const block_t* in) noexcept {
+		for(unsigned i = count; i--; )
+			v[i] = in[0][i] | (static_cast<word_t>(in[1][i]) << 32);
+	}
+	/** stores both lanes to two blocks										*/
+	inline void store(block_t* out) const noexcept {
+		for(unsigned i = count; i--; ) {
+			out[0][i] = static_cast<item_t>(v[i]);
+			out[1][i] = static_cast<item_t>(v[i] >> 32);
+		}
+	}
+	/** loads one block to lane l											*/
+	inline void load(unsigned l, const block_t& in) noexcept {
+		const word_t mask = static_cast<word_t>(0xFFFFFFFFU) << (l * 32);
+		for(unsigned i = count; i--; )
+			v[i] = (v[i] & ~mask) | (static_cast<word_t>(in[i]) << (l * 32));
+	}
+	/** stores lane l to one block											*/
+	inline void store(unsigned l, block_t& out) const noexcept {
+		for(unsigned i = count; i--; )
+			out[i] = static_cast<item_t>(v[i] >> (l * 32));
+	}
+	inline void operator^=(const Swar& val) noexcept {
+		for(unsigned i = count; i--; ) v[i] ^= val.v[i];
+	}
+	/** xors same block to both lanes										*/
+	inline void operator^=(const block_t& val) noexcept {
+		for(unsigned i = count; i--; )
+			v[i] ^= val[i] | (static_cast<word_t>(val[i]) << 32);
+	}
+	/** fills i-th item of both lanes from two items						*/
+	inline void fill(unsigned i, const item_t* in) noexcept {
+		v[i] = in[0] | (static_cast<word_t>(in[1]) << 32);
+	}
+	/** i-th item of both lanes												*/
+	inline word_t& operator[](unsigned i) noexcept { return v[i]; }
+	inline const word_t& operator[](unsigned i) const noexcept { return v[i]; }
+	/**
+	 * Chaskey transformation on both lanes
+	 */
+	inline void permute() noexcept {
+		/* compiler effectively unrolls this loop if optimizes for speed */
+		for(auto i=N; i--;) round();
+	}
+	/**
+	 * Chaskey reverse transformation on both lanes
+	 */
+	inline void etumrep() noexcept {
+		/* compiler effectively unrolls this loop if optimizes for speed */
+		for(auto i=N; i--;) dnour();
+	}
+protected:
+	static constexpr word_t msb = 0x8000000080000000ULL;
+	static inline word_t add(word_t a, word_t b) noexcept {
+		return ((a & ~msb) + (b & ~msb)) ^ ((a ^ b) & msb);
+	}
+	static inline word_t sub(word_t a, word_t b) noexcept {
+		return ((a | msb) - (b & ~msb)) ^ ((a ^ ~b) & msb);
+	}
+	template<uint_fast8_t S>
+	static inline word_t rol(word_t x) noexcept {
+		constexpr word_t lo = (0xFFFFFFFFULL >> (32 - S)) * 0x100000001ULL;
+		return ((x << S) & ~lo) | ((x >> (32 - S)) & lo);
+	}
+	template<uint_fast8_t S>
+	static inline word_t ror(word_t x) noexcept {
+		return rol<32 - S>(x);
+	}
+	/**
+	 * Chaskey round, same as Cipher<N>::round
+	 */
+	inline void round() noexcept {
+		v[0]  = add(v[0], v[1]);
+		v[1]  = rol< 5>(v[1]);
+		v[1] ^= v[0];
+		v[0]  = rol<16>(v[0]);
+		v[2]  = add(v[2], v[3]);
+		v[3]  = rol< 8>(v[3]);
+		v[3] ^= v[2];
+		v[0]  = add(v[0], v[3]);
+		v[3]  = rol<13>(v[3]);
+		v[3] ^= v[0];
+		v[2]  = add(v[2], v[1]);
+		v[1]  = rol< 7>(v[1]);
+		v[1] ^= v[2];
+		v[2]  = rol<16>(v[2]);
+	}
+	/**
+	 * Chaskey reverse round, same as Cipher<N>::dnour
+	 */
+	inline void dnour() noexcept {
+		v[2]  = ror<16>(v[2]);
+		v[1] ^= v[2];
+		v[1]  = ror< 7>(v[1]);
+		v[2]  = sub(v[2], v[1]);
+		v[3] ^= v[0];
+		v[3]  = ror<13>(v[3]);
+		v[0]  = sub(v[0], v[3]);
+		v[3] ^= v[2];
+		v[3]  = ror< 8>(v[3]);
+		v[2]  = sub(v[2], v[3]);
+		v[0]  = ror<16>(v[0]);
+		v[1] ^= v[0];
+		v[1]  = ror< 5>(v[1]);
+		v[0]  = sub(v[0], v[1]);
+	}
+	word_t v[count];
+};
+
 typedef details::block<uint32_t, 4>::block_t block_t;
 
 /**
@@ -962,12 +3623,122 @@ public:
 	using Cbc = crypto::Cbc<Cipher8s,details::block_formatter<item_t,count>>;
 	using Mac = crypto::Mac<Cipher8s,details::block_formatter<item_t,count>>;
 	using Cloc= crypto::Cloc<Cipher8s,details::block_formatter<item_t,count>>;
+	using Ctr = crypto::Ctr<Cipher8s,details::block_formatter<item_t,count>>;
+	using Pmac= crypto::Pmac<Cipher8s,details::block_formatter<item_t,count>>;
+	using Eax = crypto::Eax<Cipher8s,details::block_formatter<item_t,count>>;
+	using Xex = crypto::Xex<Cipher8s,details::block_formatter<item_t,count>>;
+	using Tree= crypto::Tree<Cipher8s,details::block_formatter<item_t,count>>;
+	using Etm = crypto::Etm<Cipher8s,details::block_formatter<item_t,count>>;
 
 	using base::operator=;
 	using base::operator==;
 	void permute() noexcept;
 	void etumrep() noexcept;
 	static void derive(block_t& v, const block_t& in) noexcept;
+	/**
+	 * Batch entry points with kernel selected at run time on x86
+	 * (scalar, sse2, avx2 or avx512), environment variable CHASKEY_KERNEL
+	 * forces a particular kernel if supported by the CPU.
+	 * On other targets kernel is the one of Cipher<8>::Batch
+	 */
+	struct Batch {
+		static void permute(block_t* blocks, unsigned count) noexcept;
+		static void etumrep(block_t* blocks, unsigned count) noexcept;
+		/** name of the kernel in use										*/
+		static const char* kernel() noexcept;
+	};
+};
+
+/**
+ * Cipher8h - implements Chaskey8 with entire state kept in one vector
+ * register as {v0,v2,v1,v3}, so that both half-round chains (v0,v1) and
+ * (v2,v3) are computed with the same vector instruction.
+ * Relies on per-lane variable shifts (AVX2, NEON), on plain SSE2
+ * compiler falls back to scalar shifts
+ */
+class Cipher8h : public Cipher<8> {
+public:
+	typedef Cipher<8> base;
+	static unsigned constexpr count = base::count; /* == 4 */
+	using base::block_t;
+	using base::Block;
+	using Cbc = crypto::Cbc<Cipher8h,details::block_formatter<item_t,count>>;
+	using Mac = crypto::Mac<Cipher8h,details::block_formatter<item_t,count>>;
+	using Cloc= crypto::Cloc<Cipher8h,details::block_formatter<item_t,count>>;
+	using Ctr = crypto::Ctr<Cipher8h,details::block_formatter<item_t,count>>;
+	using Pmac= crypto::Pmac<Cipher8h,details::block_formatter<item_t,count>>;
+	using Eax = crypto::Eax<Cipher8h,details::block_formatter<item_t,count>>;
+	using Xex = crypto::Xex<Cipher8h,details::block_formatter<item_t,count>>;
+	using Tree= crypto::Tree<Cipher8h,details::block_formatter<item_t,count>>;
+	using Etm = crypto::Etm<Cipher8h,details::block_formatter<item_t,count>>;
+
+	using base::operator=;
+	using base::operator==;
+	inline void permute() noexcept {
+		lane_t x = { v[0], v[2], v[1], v[3] };
+		for(auto i=8; i--;) round(x);
+		store(x);
+	}
+	inline void etumrep() noexcept {
+		lane_t x = { v[0], v[2], v[1], v[3] };
+		for(auto i=8; i--;) dnour(x);
+		store(x);
+	}
+	static constexpr const Cipher8h& cast(const void* blk) noexcept {
+		return static_cast<const Cipher8h&>(base::cast(blk));
+	}
+	static constexpr Cipher8h& cast(void* blk) noexcept {
+		return static_cast<Cipher8h&>(base::cast(blk));
+	}
+protected:
+	typedef details::vector<item_t, 4>::type lane_t;
+	typedef details::vector<int32_t, 4>::type mask_t;
+	static inline lane_t rol(lane_t x, lane_t n) noexcept {
+		return (x << n) | (x >> ((32 - n) & 31));
+	}
+	static inline lane_t ror(lane_t x, lane_t n) noexcept {
+		return (x >> n) | (x << ((32 - n) & 31));
+	}
+	/* shuffles pairing lanes {v0,v2} with {v1,v3} and with {v3,v1}		*/
+	static inline lane_t swap(lane_t x) noexcept {
+		return __builtin_shuffle(x, mask_t{2,3,0,1});
+	}
+	static inline lane_t cross(lane_t x) noexcept {
+		return __builtin_shuffle(x, mask_t{3,2,1,0});
+	}
+	/**
+	 * Chaskey round, same as Cipher<N>::round
+	 */
+	static inline void round(lane_t& x) noexcept {
+		constexpr lane_t lo = { ~0U, ~0U, 0, 0 };
+		constexpr lane_t hi = { 0, 0, ~0U, ~0U };
+		x += swap(x) & lo;				/* v0 += v1; v2 += v3				*/
+		x  = rol(x, lane_t{ 0, 0, 5, 8});
+		x ^= swap(x) & hi;				/* v1 ^= v0; v3 ^= v2				*/
+		x  = rol(x, lane_t{16, 0, 0, 0});
+		x += cross(x) & lo;				/* v0 += v3; v2 += v1				*/
+		x  = rol(x, lane_t{ 0, 0, 7,13});
+		x ^= cross(x) & hi;				/* v1 ^= v2; v3 ^= v0				*/
+		x  = rol(x, lane_t{ 0,16, 0, 0});
+	}
+	/**
+	 * Chaskey reverse round, same as Cipher<N>::dnour
+	 */
+	static inline void dnour(lane_t& x) noexcept {
+		constexpr lane_t lo = { ~0U, ~0U, 0, 0 };
+		constexpr lane_t hi = { 0, 0, ~0U, ~0U };
+		x  = ror(x, lane_t{ 0,16, 0, 0});
+		x ^= cross(x) & hi;
+		x  = ror(x, lane_t{ 0, 0, 7,13});
+		x -= cross(x) & lo;
+		x  = ror(x, lane_t{16, 0, 0, 0});
+		x ^= swap(x) & hi;
+		x  = ror(x, lane_t{ 0, 0, 5, 8});
+		x -= swap(x) & lo;
+	}
+	inline void store(lane_t x) noexcept {
+		v[0] = x[0]; v[2] = x[1]; v[1] = x[2]; v[3] = x[3];
+	}
 };
 
 
@@ -978,15 +3749,19 @@ public:
 class Chaskey8 : public Cipher8 {
 public:
 	typedef uint8_t tag_t[sizeof(block_t)];
+	typedef details::arch_traits::size_t size_t;
 	/**
 	 * computes message digest, and writes results to tag
 	 */
-	void sign(tag_t& tag, const uint8_t* msg, uint_fast16_t len,
+	void sign(tag_t& tag, const uint8_t* msg, size_t len,
 			const block_t& key,	const block_t& subkey1,
 			const block_t& subkey2) noexcept {
 		details::block_formatter<item_t, count> buff;
 		const block_t* finalkey = nullptr;
 		init(key);
+		auto run = buff.runs(msg, len, true);
+		details::absorb<decltype(buff)>(static_cast<Cipher8&>(*this),
+			run.data, run.count);
 		do {
 			buff.append(msg, len);
 			if( ! len ) {
@@ -24,6 +24,11 @@
  * https://opensource.org/licenses/MIT
  */
 #include "chaskey.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#	define CHASKEY_DISPATCH
+#	include <stdlib.h>
+#	include <string.h>
+#endif
 namespace crypto {
 namespace chaskey {
 void Cipher8s::permute() noexcept {
@@ -38,4 +43,113 @@ void Cipher8s::derive(block_t& v, const block_t& in) noexcept {
 	base::derive(v,in);
 }
 
+#ifdef CHASKEY_DISPATCH
+namespace {
+typedef void (*transform_t)(block_t*, unsigned);
+
+struct kernel_t {
+	const char* name;
+	bool (*supported)();
+	transform_t permute;
+	transform_t etumrep;
+};
+
+void scalar_permute(block_t* blocks, unsigned count) noexcept {
+	for(; count--; ++blocks) Cipher<8>::cast(blocks).permute();
+}
+
+void scalar_etumrep(block_t* blocks, unsigned count) noexcept {
+	for(; count--; ++blocks) Cipher<8>::cast(blocks).etumrep();
+}
+
+/* flatten inlines the kernel, so that it is compiled for the target ISA	*/
+__attribute__((target("sse2"),flatten))
+void sse2_permute(block_t* blocks, unsigned count) noexcept {
+	details::batch<Lanes<8,4>>::permute(blocks, count);
+}
+
+__attribute__((target("sse2"),flatten))
+void sse2_etumrep(block_t* blocks, unsigned count) noexcept {
+	details::batch<Lanes<8,4>>::etumrep(blocks, count);
+}
+
+__attribute__((target("avx2"),flatten))
+void avx2_permute(block_t* blocks, unsigned count) noexcept {
+	details::batch<Lanes<8,8>>::permute(blocks, count);
+}
+
+__attribute__((target("avx2"),flatten))
+void avx2_etumrep(block_t* blocks, unsigned count) noexcept {
+	details::batch<Lanes<8,8>>::etumrep(blocks, count);
+}
+
+/* gcc recognizes rotates on vectors and emits VPROLD/VPRORD			*/
+__attribute__((target("avx512f"),flatten))
+void avx512_permute(block_t* blocks, unsigned count) noexcept {
+	details::batch<Lanes<8,16>>::permute(blocks, count);
+}
+
+__attribute__((target("avx512f"),flatten))
+void avx512_etumrep(block_t* blocks, unsigned count) noexcept {
+	details::batch<Lanes<8,16>>::etumrep(blocks, count);
+}
+
+/* __builtin_cpu_supports accepts string literals only					*/
+bool has_avx512() { return __builtin_cpu_supports("avx512f"); }
+bool has_avx2()   { return __builtin_cpu_supports("avx2"); }
+bool has_sse2()   { return __builtin_cpu_supports("sse2"); }
+bool has_none()   { return true; }
+
+/* ordered from the best to the worst									*/
+const kernel_t kernels[] = {
+	{ "avx512", has_avx512, avx512_permute, avx512_etumrep },
+	{ "avx2",   has_avx2,   avx2_permute,   avx2_etumrep   },
+	{ "sse2",   has_sse2,   sse2_permute,   sse2_etumrep   },
+	{ "scalar", has_none,   scalar_permute, scalar_etumrep },
+};
+
+const kernel_t& select() noexcept {
+	__builtin_cpu_init();
+	const char* forced = getenv("CHASKEY_KERNEL");
+	if( forced ) {
+		for(const kernel_t& kernel : kernels)
+			if( strcmp(forced, kernel.name) == 0 && kernel.supported() )
+				return kernel;
+	}
+	for(const kernel_t& kernel : kernels)
+		if( kernel.supported() ) return kernel;
+	return kernels[sizeof(kernels)/sizeof(kernels[0])-1];
+}
+
+/* selected once, on first use											*/
+inline const kernel_t& current() noexcept {
+	static const kernel_t& kernel = select();
+	return kernel;
+}
+}
+
+void Cipher8s::Batch::permute(block_t* blocks, unsigned count) noexcept {
+	current().permute(blocks, count);
+}
+
+void Cipher8s::Batch::etumrep(block_t* blocks, unsigned count) noexcept {
+	current().etumrep(blocks, count);
+}
+
+const char* Cipher8s::Batch::kernel() noexcept {
+	return current().name;
+}
+#else
+void Cipher8s::Batch::permute(block_t* blocks, unsigned count) noexcept {
+	base::Batch::permute(blocks, count);
+}
+
+void Cipher8s::Batch::etumrep(block_t* blocks, unsigned count) noexcept {
+	base::Batch::etumrep(blocks, count);
+}
+
+const char* Cipher8s::Batch::kernel() noexcept {
+	return "static";
+}
+#endif
 }}
@@ -0,0 +1,213 @@
+/* chaskeymt.hpp - running Chaskey modes on threads, for hosted targets
+ * Chaskey algorithm invented by Nicky Mouha http://mouha.be/chaskey/
+ *
+ * Copyright (C) 2017 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ * https://opensource.org/licenses/MIT
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "chaskey.hpp"
+
+/*
+ * chaskey.hpp stays free of the standard library, so that it builds for
+ * MCUs. Helpers that need threads are kept here.
+ */
+namespace crypto {
+namespace mt {
+
+/** number of threads to use by default									*/
+inline unsigned threads() noexcept {
+	unsigned n = std::thread::hardware_concurrency();
+	return n ? n : 1;
+}
+
+/**
+ * parallel - splits count items in up to threads contiguous ranges and
+ * calls fn(first, n) for each range on its own thread, the calling thread
+ * takes the last range. Returns when all ranges are done
+ */
+template<class Fn>
+void parallel(uint64_t count, unsigned threads, Fn&& fn) {
+	if( ! threads ) threads = 1;
+	if( threads > count ) threads = count ? count : 1;
+	std::vector<std::thread> pool;
+	pool.reserve(threads - 1);
+	uint64_t first = 0;
+	for(unsigned t = threads; t > 1; --t) {
+		uint64_t n = (count - first) / t;
+		pool.emplace_back([&fn, first, n]() { fn(first, n); });
+		first += n;
+	}
+	fn(first, count - first);
+	for(auto& thread : pool) thread.join();
+}
+
+/**
+ * encrypts in place count consecutive sectors of size bytes, starting
+ * from sector first, spreading ranges of sectors over threads.
+ * Returns false and leaves data unchanged if size is not valid for Xex
+ */
+template<class Xex>
+bool encrypt(const Xex& xex, typename Xex::sector_t first, uint8_t* data,
+		typename Xex::sector_t count, typename Xex::size_t size,
+		unsigned threads = mt::threads()) {
+	if( ! Xex::valid(size) ) return false;
+	parallel(count, threads, [&](uint64_t i, uint64_t n) {
+		xex.encrypt(first + i, data + i * size, n, size);
+	});
+	return true;
+}
+
+/**
+ * decrypts in place count consecutive sectors of size bytes, starting
+ * from sector first, spreading ranges of sectors over threads.
+ * Returns false and leaves data unchanged if size is not valid for Xex
+ */
+template<class Xex>
+bool decrypt(const Xex& xex, typename Xex::sector_t first, uint8_t* data,
+		typename Xex::sector_t count, typename Xex::size_t size,
+		unsigned threads = mt::threads()) {
+	if( ! Xex::valid(size) ) return false;
+	parallel(count, threads, [&](uint64_t i, uint64_t n) {
+		xex.decrypt(first + i, data + i * size, n, size);
+	});
+	return true;
+}
+
+/**
+ * pool - fixed set of threads running jobs of count independent items.
+ * Items are taken one at a time from a shared counter, so that threads
+ * finishing early take more items. The calling thread works too
+ */
+class pool {
+public:
+	explicit pool(unsigned threads = mt::threads()) {
+		for(unsigned t = 1; t < threads; ++t)
+			workers.emplace_back([this]() { work(); });
+	}
+	pool(const pool&) = delete;
+	~pool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		wake.notify_all();
+		for(auto& thread : workers) thread.join();
+	}
+	/** number of threads, including the calling one						*/
+	unsigned size() const noexcept { return workers.size() + 1; }
+	/** calls fn(i) for each i in [0, count), returns when all are done	*/
+	void run(uint64_t count, const std::function<void(uint64_t)>& fn) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job   = &fn;
+			total = count;
+			next  = 0;
+			done  = 0;
+			++generation;
+		}
+		wake.notify_all();
+		uint64_t n = take(fn, count);
+		std::unique_lock<std::mutex> lock(mutex);
+		done += n;
+		/* workers that joined this job must leave it before the next one	*/
+		finished.wait(lock, [this]() { return done == total && ! active; });
+		job = nullptr;
+	}
+private:
+	void work() {
+		unsigned long seen = 0;
+		for(;;) {
+			const std::function<void(uint64_t)>* fn;
+			uint64_t count;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this, seen]() {
+					return stop || generation != seen; });
+				if( stop ) return;
+				seen  = generation;
+				fn    = job;
+				count = total;
+				++active;
+			}
+			uint64_t n = fn ? take(*fn, count) : 0;
+			std::lock_guard<std::mutex> lock(mutex);
+			done += n;
+			if( ! --active && done == total ) finished.notify_one();
+		}
+	}
+	/** takes items from the shared counter, returns number of items done	*/
+	uint64_t take(const std::function<void(uint64_t)>& fn, uint64_t count) {
+		uint64_t i, n = 0;
+		while( (i = next++) < count ) {
+			fn(i);
+			++n;
+		}
+		return n;
+	}
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	const std::function<void(uint64_t)>* job = nullptr;
+	std::atomic<uint64_t> next {0};
+	uint64_t total = 0;
+	uint64_t done  = 0;
+	unsigned active = 0;
+	unsigned long generation = 0;
+	bool stop = false;
+};
+
+/**
+ * signs message msg of length len with tree, leaves are spread over the
+ * pool threads in batches, their tags are appended in order, so that
+ * the result does not depend on the number of threads
+ */
+template<class Tree>
+void sign(Tree& tree, pool& threads, const uint8_t* msg, uint64_t len) {
+	typedef typename Tree::block_t block_t;
+	constexpr unsigned batch = 256;
+	const auto& ctx = tree.leaves();
+	const uint64_t leaf = tree.leaf();
+	const uint64_t leaves = len ? (len + leaf - 1) / leaf : 1;
+	block_t tags[batch];
+	tree.init();
+	for(uint64_t first = 0; first < leaves; first += batch) {
+		uint64_t n = leaves - first < batch ? leaves - first : batch;
+		threads.run(n, [&](uint64_t i) {
+			uint64_t offset = (first + i) * leaf;
+			uint64_t size = len - offset < leaf ? len - offset : leaf;
+			Tree::sign(tags[i], ctx, msg + offset, size);
+		});
+		for(unsigned i = 0; i < n; ++i) tree.append(tags[i]);
+	}
+	tree.finish(len);
+}
+
+}
+}
@@ -87,6 +87,7 @@ struct options {
 	bool hexout;
 	bool hexkey;
 	bool aes128cloc;
+	bool eax;
 	bool tocerr;
 	unsigned long param;
 };
@@ -103,7 +104,7 @@ private:
 
 void fillopts(int argc, char * const argv[], options& opts) {
 	char c;
-	while(-1 != (c = getopt(argc, argv, "edsm:cu:o:V:N:tT:b:k:K:i:I:X:a:A:hvqr2"))){
+	while(-1 != (c = getopt(argc, argv, "edsm:cu:o:V:N:tT:b:k:K:i:I:X:a:A:hvqrp2"))){
 		switch(c) {
 		case 'e': opts.oper = operation::encrypt; break;
 		case 'd': opts.oper = operation::decrypt; break;
@@ -129,6 +130,7 @@ void fillopts(int argc, char * const argv[], options& opts) {
 #		ifdef WITH_AES128CLOC_TEST
 		case 'r': opts.aes128cloc = true;  break;
 #		endif
+		case 'p': opts.eax = true;  break;
 		case '?': opts.oper = operation::help; break;
 		case 'T': opts.oper = operation::masters; opts.param = strtol(optarg,nullptr, 10);	break;
 		case 'b': opts.oper = operation::bench;	opts.param = strtol(optarg,nullptr, 10); break;
@@ -376,13 +378,14 @@ static int aes128cloc(istream& in, istream& ad, ostream& out,
 #else
 static int aes128cloc(istream&, istream&, ostream&,
 		const block_t&, const char*, bool, const byte* mac) throw(error) {
-	throw error(string("aes128 is not available");
+	throw error(string("aes128 is not available"));
 }
 #endif
 
+template<class Aead>
 static int cloc(istream& in, istream& ad, ostream& out,
 		const block_t& key, const char* nonce, bool hexout, bool tocerr) {
-	crypto::chaskey::Cipher8::Cloc cloc(key);
+	Aead cloc(key);
 	while(ad) {
 		char plaintext[sizeof(block_t)];
 		size_t len = ad.read(plaintext,sizeof(plaintext)).gcount();
@@ -406,9 +409,10 @@ static int cloc(istream& in, istream& ad, ostream& out,
 	return success;
 }
 
+template<class Aead>
 static int uncloc(istream& in, istream& ad, ostream& out, const block_t& key,
 		const char* nonce, const uint8_t* signature, uint_fast8_t len) {
-	crypto::chaskey::Cipher8::Cloc cloc(key);
+	Aead cloc(key);
 	while(ad) {
 		char plaintext[sizeof(block_t)];
 		size_t len = ad.read(plaintext,sizeof(plaintext)).gcount();
@@ -467,6 +471,7 @@ static int help() {
 		 << "  -k <f> : read key from file <f>" << endl
 		 << "  -h     : write signature in hexadecimal" << endl
 		 << "  -2     : write hexadecimal signature to stderr" << endl
+		 << "  -p     : use parallel EAX (CTR+PMAC) instead of CLOC with -c/-u" << endl
 		 << "  -v     : set verbose mode" << endl
 		 << "  -q     : set quite mode" << endl << endl
 		 << "For example: " << endl
@@ -575,7 +580,11 @@ int main(int argc, char * const argv[]) {
 		istream& ad ( adata(opts) );
 		return opts.aes128cloc
 			? aes128cloc(in, ad, out, key, opts.nonce, opts.hexout, nullptr)
-		    : cloc(in, ad, out, key, opts.nonce, opts.hexout, opts.tocerr);
+			: opts.eax
+			? cloc<crypto::chaskey::Cipher8::Eax>(in, ad, out, key, opts.nonce,
+				opts.hexout, opts.tocerr)
+			: cloc<crypto::chaskey::Cipher8::Cloc>(in, ad, out, key, opts.nonce,
+				opts.hexout, opts.tocerr);
 	}
 	case operation::uncloc: {
 		istream& ad ( adata(opts) );
@@ -595,7 +604,11 @@ int main(int argc, char * const argv[]) {
 		if( ! ad ) return ioerror;
 		int res = opts.aes128cloc
 			? aes128cloc(in, ad, out, key, opts.nonce, len, digest)
-			: uncloc(in, ad, out, key, opts.nonce, mac, len);
+			: opts.eax
+			? uncloc<crypto::chaskey::Cipher8::Eax>(in, ad, out, key,
+				opts.nonce, mac, len)
+			: uncloc<crypto::chaskey::Cipher8::Cloc>(in, ad, out, key,
+				opts.nonce, mac, len);
 		if( verbosity > 1 && res == success )
 			cerr << "Verified" << endl;
 		if( verbosity >= 1 && res != success )
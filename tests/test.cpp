@@ -40,6 +40,21 @@
 #	include <ChaCha.h>
 	// chacha takes ~6200 bytes of ROM on AVR
 #endif
+#if !defined(__AVR__) && !defined(__MSP430__)
+	// lanes and vector ciphers are too heavy for 8 and 16 bit MCUs
+#	define WITH_LANES_TEST
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+#	define WITH_UIO_TEST
+#	include <sys/uio.h>
+#endif
+#if defined(__linux__) || defined(__APPLE__) || defined(_WIN32)
+	// threads and buffers larger 64K are available on hosted targets only
+#	define WITH_THREADS_TEST
+#	define WITH_LARGE_TEST
+#	include <chrono>
+#	include "chaskeymt.hpp"
+#endif
 namespace impl {
 #if defined(__AVR__) || defined(__MSP430__)
 	typedef crypto::chaskey::Cipher8s Cipher8;
@@ -165,6 +180,13 @@ extern unsigned long milliseconds();
 alignas(4)
 static uint8_t blank[32];
 
+/* size of static buffers in bulk benches, 8 and 16-bit MCUs have few KB	*/
+#if defined(__AVR__) || defined(__MSP430__)
+static constexpr unsigned chunk_size = 128;
+#else
+static constexpr unsigned chunk_size = 1024;
+#endif
+
 unsigned long bench_refmac(unsigned long count) {
 	block_t subkey1{}, subkey2{}, k1{};
 	auto start = milliseconds();
@@ -191,16 +213,101 @@ struct blockassignwrapper {
 unsigned long bench_mac(unsigned long count) {
 	impl::Cipher8::Mac mac;
 	const block_t& key{Test::vectors[0]};
-	impl::Cipher8::Block result;
 	mac.set(key);
 	auto start = milliseconds();
 	while(count--) {
 		mac.init();
 		mac.update(blank,sizeof(blank),true);
-		mac.write(blockassignwrapper{result});
+		/* chained through the message, so the loop cannot be hoisted	*/
+		mac.write(memcpywrapper{blank,0});
+	}
+	return milliseconds() - start;
+}
+
+/* MACs count*32 bytes in messages of the given size, fed by 512 bytes	*/
+unsigned long bench_bulk(unsigned long count, unsigned long size) {
+	alignas(4) static uint8_t chunk[512];
+	impl::Cipher8::Mac mac;
+	const block_t& key{Test::vectors[0]};
+	unsigned long messages = (count * sizeof(blank) + size - 1) / size;
+	mac.set(key);
+	auto start = milliseconds();
+	while(messages--) {
+		mac.init();
+		for(unsigned long len = size; len > sizeof(chunk); len -= sizeof(chunk))
+			mac.update(chunk, sizeof(chunk), false);
+		mac.update(chunk, size > sizeof(chunk) ? sizeof(chunk) : size, true);
+		mac.write(memcpywrapper{chunk,0});
+	}
+	return milliseconds() - start;
+}
+
+/* signs count*32 bytes in 1K messages fed by chunk_size bytes, starting
+ * at the given offset from an aligned buffer, with Mac on the given
+ * formatter																*/
+template<class Formatter>
+unsigned long bench_align(unsigned long count, unsigned offset) {
+	alignas(4) static uint8_t chunk[chunk_size + 4];
+	crypto::Mac<Cipher8,Formatter> mac(Test::vectors[0]);
+	unsigned long messages = (count * sizeof(blank) + 1023) / 1024;
+	auto start = milliseconds();
+	while(messages--) {
+		unsigned long len = 1024;
+		mac.init();
+		for(; len > chunk_size; len -= chunk_size)
+			mac.update(chunk + offset, chunk_size, false);
+		mac.update(chunk + offset, len, true);
+		mac.write(memcpywrapper{chunk + offset, 0});
+	}
+	return milliseconds() - start;
+}
+
+#ifdef WITH_LANES_TEST
+unsigned long bench_hmac(unsigned long count) {
+	Cipher8h::Mac mac;
+	const block_t& key{Test::vectors[0]};
+	mac.set(key);
+	auto start = milliseconds();
+	while(count--) {
+		mac.init();
+		mac.update(blank,sizeof(blank),true);
+		mac.write(memcpywrapper{blank,0});
+	}
+	return milliseconds() - start;
+}
+#endif
+
+#ifdef WITH_LANES_TEST
+/* permutes as many blocks as count MACs on 32 bytes do, in batches		*/
+unsigned long bench_batch(unsigned long count) {
+	static block_t blocks[64];
+	memcpy(blocks, Test::vectors, sizeof(blocks));
+	count = (count * 2 + 63) / 64;
+	auto start = milliseconds();
+	while(count--)
+		Cipher8::Batch::permute(blocks, 64);
+	return milliseconds() - start;
+}
+
+/* verifies count messages of 32 bytes, in batches of 64				*/
+unsigned long bench_macbatch(unsigned long count) {
+	static Cipher8::Mac::context key;
+	static Cipher8::Mac::item items[64];
+	static block_t tags[64];
+	uint32_t mask[2];
+	key.set(Test::vectors[0]);
+	for(unsigned i = 0; i < 64; ++i)
+		items[i] = { &key, blank, sizeof(blank), tags + i };
+	count = (count + 63) / 64;
+	auto start = milliseconds();
+	while(count--) {
+		Cipher8::Mac::verify<Cipher8::Kernel>(mask, items, 64);
+		/* chained through the message, so the loop cannot be hoisted	*/
+		blank[0] ^= mask[0];
 	}
 	return milliseconds() - start;
 }
+#endif
 
 #ifdef WITH_AES128CLOC_TEST
 unsigned long bench_aes128cloc(unsigned long count) {
@@ -254,6 +361,26 @@ unsigned long bench_cloc(unsigned long count) {
 	return milliseconds() - start;
 }
 
+#ifdef WITH_LANES_TEST
+/* seals count packets as in bench_cloc, in batches of 64				*/
+unsigned long bench_clocbatch(unsigned long count) {
+	using Cloc = impl::Cipher8::Cloc;
+	static uint8_t ad[32], nonce[16], pt[32], ct[64][32], tags[64][16];
+	static Cloc::packet packets[64];
+	for(unsigned i = 0; i < 64; ++i)
+		packets[i] = { Test::vectors, ad, sizeof(ad), nonce, sizeof(nonce),
+			pt, ct[i], sizeof(pt), tags[i] };
+	count = (count + 63) / 64;
+	auto start = milliseconds();
+	while(count--) {
+		Cloc::seal<Cipher8::Lanes<>>(packets, 64);
+		/* chained through the nonce, so the loop cannot be hoisted		*/
+		nonce[0] ^= tags[63][0];
+	}
+	return milliseconds() - start;
+}
+#endif
+
 unsigned long bench_encrypt(unsigned long count) {
 	const block_t& key{Test::vectors[0]};
 	const block_t& iv{Test::vectors[1]};
@@ -280,14 +407,202 @@ unsigned long bench_decrypt(unsigned long count) {
 	return milliseconds() - start;
 }
 
+/* decrypts count*32 bytes in messages of the given size, in place by
+ * chunk_size bytes															*/
+unsigned long bench_bulkdecrypt(unsigned long count, unsigned long size) {
+	alignas(4) static uint8_t chunk[chunk_size];
+	const block_t& key{Test::vectors[0]};
+	const block_t& iv{Test::vectors[1]};
+	impl::Cipher8::Cbc cbc;
+	unsigned long messages = (count * sizeof(blank) + size - 1) / size;
+	cbc.set(key);
+	auto start = milliseconds();
+	while(messages--) {
+		unsigned long len = size;
+		cbc.init(iv);
+		for(; len > sizeof(chunk); len -= sizeof(chunk))
+			cbc.decrypt(memcpywrapper{chunk, 0}, chunk, sizeof(chunk));
+		cbc.decrypt(memcpywrapper{chunk, 0}, chunk, len);
+	}
+	return milliseconds() - start;
+}
+#ifdef WITH_LANES_TEST
+unsigned long bench_pmac(unsigned long count, unsigned long size) {
+	alignas(4) static uint8_t chunk[512];
+	impl::Cipher8::Pmac pmac;
+	const block_t& key{Test::vectors[0]};
+	unsigned long messages = (count * sizeof(blank) + size - 1) / size;
+	pmac.set(key);
+	auto start = milliseconds();
+	while(messages--) {
+		pmac.init();
+		for(unsigned long len = size; len > sizeof(chunk); len -= sizeof(chunk))
+			pmac.update(chunk, sizeof(chunk), false);
+		pmac.update(chunk, size > sizeof(chunk) ? sizeof(chunk) : size, true);
+		pmac.write(memcpywrapper{chunk,0});
+	}
+	return milliseconds() - start;
+}
+#endif
+
+#ifdef WITH_LARGE_TEST
+/* encrypts and signs count*32 bytes in messages of the given size, either
+ * with Cbc to a buffer and then Mac of the buffer, or with fused Etm		*/
+unsigned long bench_etm(unsigned long count, unsigned long size, bool fused) {
+	alignas(4) static uint8_t chunk[1024], out[65536];
+	const block_t& iv{Test::vectors[1]};
+	impl::Cipher8::Cbc cbc(Test::vectors[0]);
+	impl::Cipher8::Mac mac(Test::vectors[2]);
+	impl::Cipher8::Etm etm(Test::vectors[0], Test::vectors[2]);
+	if( size > sizeof(out) ) size = sizeof(out);
+	unsigned long messages = (count * sizeof(blank) + size - 1) / size;
+	auto start = milliseconds();
+	while(messages--) {
+		unsigned long len = size;
+		if( fused ) {
+			etm.init(iv);
+			for(; len > sizeof(chunk); len -= sizeof(chunk))
+				etm.encrypt(memcpywrapper{out,0}, chunk, sizeof(chunk), false);
+			etm.encrypt(memcpywrapper{out,0}, chunk, len, true);
+			etm.write(memcpywrapper{chunk,0});
+			continue;
+		}
+		memcpywrapper wrp{out, 0};
+		cbc.init(iv);
+		for(; len > sizeof(chunk); len -= sizeof(chunk))
+			cbc.encrypt(wrp, chunk, sizeof(chunk), false);
+		cbc.encrypt(wrp, chunk, len, true);
+		mac.init();
+		for(len = 0; wrp.size - len > sizeof(chunk); len += sizeof(chunk))
+			mac.update(out + len, sizeof(chunk), false);
+		mac.update(out + len, wrp.size - len, true);
+		mac.write(memcpywrapper{chunk,0});
+	}
+	return milliseconds() - start;
+}
+#endif
+
+/* seals count*32 bytes in messages of the given size, 512 bytes a call	*/
+template<class Aead>
+unsigned long bench_aead(unsigned long count, unsigned long size) {
+	alignas(4) static uint8_t chunk[512], out[512];
+	uint8_t ad[32] {}, nonce[16] {};
+	Aead aead;
+	unsigned long messages = (count * sizeof(blank) + size - 1) / size;
+	aead.set(Test::vectors[0]);
+	auto start = milliseconds();
+	while(messages--) {
+		aead.init();
+		aead.update(ad, sizeof(ad), true);
+		aead.nonce(nonce, sizeof(nonce));
+		for(unsigned long len = size; len > sizeof(chunk); len -= sizeof(chunk))
+			aead.encrypt(memcpywrapper{out,0}, chunk, sizeof(chunk), false);
+		aead.encrypt(memcpywrapper{out,0}, chunk,
+			size > sizeof(chunk) ? sizeof(chunk) : size, true);
+		aead.write(memcpywrapper{out,0});
+	}
+	return milliseconds() - start;
+}
+
+#ifdef WITH_THREADS_TEST
+/* milliseconds() may count CPU time of all threads, benches on threads
+ * measure wall time														*/
+static unsigned long wallclock() {
+	using namespace std::chrono;
+	return duration_cast<std::chrono::milliseconds>(
+		steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * decrypts count*32 bytes of a 16M image in 4K sectors: sequentially in
+ * ranges of 64 sectors, at random one sector a call, or on all threads
+ */
+enum class access { sequential, random, threads };
+unsigned long bench_xex(unsigned long count, access mode) {
+	constexpr unsigned size = 4096, sectors = 4096;
+	static uint8_t image[size * sectors];
+	impl::Cipher8::Xex xex(Test::vectors[0]);
+	unsigned long total = (count * sizeof(blank) + size - 1) / size;
+	uint32_t rnd = 1;
+	unsigned s = 0;
+	memset(image, 0, sizeof(image));	/* fault pages in before timing	*/
+	auto start = wallclock();
+	switch( mode ) {
+	case access::sequential:
+		for(unsigned n; total; total -= n, s = (s + n) % sectors) {
+			n = total < 64 ? total : 64;
+			if( n > sectors - s ) n = sectors - s;
+			xex.decrypt(s, image + s * size, n, size);
+		}
+		break;
+	case access::random:
+		while( total-- ) {
+			rnd = rnd * 1664525 + 1013904223;
+			s = (rnd >> 8) % sectors;
+			xex.decrypt(s, image + s * size, size);
+		}
+		break;
+	case access::threads:
+		for(unsigned n; total; total -= n) {
+			n = total < sectors ? total : sectors;
+			crypto::mt::decrypt(xex, 0, image, n, size);
+		}
+		break;
+	}
+	return wallclock() - start;
+}
+
+/* signs count*32 bytes as 16M messages with Tree MAC on a pool of threads	*/
+unsigned long bench_tree(unsigned long count, unsigned threads) {
+	static uint8_t message[16777216UL];
+	impl::Cipher8::Tree tree(Test::vectors[0]);
+	crypto::mt::pool pool(threads);
+	unsigned long messages = (count * sizeof(blank) + sizeof(message) - 1)
+		/ sizeof(message);
+	memset(message, 0, sizeof(message));	/* fault pages in before timing	*/
+	auto start = wallclock();
+	while(messages--)
+		crypto::mt::sign(tree, pool, message, sizeof(message));
+	return wallclock() - start;
+}
+#endif
+
+/* encrypts count*32 bytes in place in messages of the given size,
+ * by chunk_size bytes														*/
+unsigned long bench_ctr(unsigned long count, unsigned long size) {
+	alignas(4) static uint8_t chunk[chunk_size];
+	const block_t& key{Test::vectors[0]};
+	const block_t& iv{Test::vectors[1]};
+	impl::Cipher8::Ctr ctr;
+	unsigned long messages = (count * sizeof(blank) + size - 1) / size;
+	ctr.set(key);
+	auto start = milliseconds();
+	while(messages--) {
+		unsigned long len = size;
+		ctr.init(iv);
+		for(; len > sizeof(chunk); len -= sizeof(chunk))
+			ctr.encrypt(chunk, sizeof(chunk));
+		ctr.encrypt(chunk, len);
+	}
+	return milliseconds() - start;
+}
 
 bool bench(unsigned long count) {
-	log.info("|%-12s|%-12s|%-12s|%-12s|%-12s|",
-			"  Ref MAC", "  Cpp MAC", "   MAC"," Encrypt", " Decrypt");
+	log.info("|%-12s|%-12s|%-12s|",
+			"  Ref MAC", "  Cpp MAC", "   MAC");
+#	ifdef WITH_LANES_TEST
+	log.info("%-12s|","  H MAC");
+#	endif
+	log.info("%-12s|%-12s|", " Encrypt", " Decrypt");
 #	ifdef WITH_AES128CLOC_TEST
 	log.info("%-12s|"," aes128cloc");
 #	endif
 	log.info("%-12s|","   CLOC");
+#	ifdef WITH_LANES_TEST
+	log.info("%-12s|","   Batch");
+	log.info("%-12s|"," Batch MAC");
+	log.info("%-12s|"," Batch CLOC");
+#	endif
 #	ifdef WITH_CHACHA_TEST
 	log.info("%-12s|","  ChaCha");
 #	endif
@@ -298,17 +613,91 @@ bool bench(unsigned long count) {
 		log.warn("|%8lu%4s", bench_refmac(count),"");
 	log.warn("|%8lu%4s", bench_cppmac(count),"");
 	log.warn("|%8lu%4s", bench_mac(count),"");
+#	ifdef WITH_LANES_TEST
+	log.warn("|%8lu%4s", bench_hmac(count),"");
+#	endif
 	log.warn("|%8lu%4s", bench_encrypt(count),"");
 	log.warn("|%8lu%4s", bench_decrypt(count),"");
 #	ifdef WITH_AES128CLOC_TEST
 	log.warn("|%8lu%4s", bench_aes128cloc(count),"");
 #	endif
 	log.warn("|%8lu%4s", bench_cloc(count),"");
+#	ifdef WITH_LANES_TEST
+	log.warn("|%8lu%4s", bench_batch(count),"");
+	log.warn("|%8lu%4s", bench_macbatch(count),"");
+	log.warn("|%8lu%4s", bench_clocbatch(count),"");
+#	endif
 #	ifdef WITH_CHACHA_TEST
 	log.warn("|%8lu%4s", bench_chacha(count),"");
 #	endif
 
 	log.warn("|\n");
+	log.info("|%-12s|", "  MAC 1K");
+#	ifdef WITH_LARGE_TEST
+	log.info("%-12s|%-12s|", "  MAC 64K", "  MAC 16M");
+#	endif
+	log.info("%-12s|%-12s|", " Decrypt 1K", "  CTR 1K");
+#	ifdef WITH_LANES_TEST
+	log.info("%-12s|", " PMAC 64K");
+#	endif
+#	ifdef WITH_LARGE_TEST
+	log.info("%-12s|%-12s|", " CBC+MAC 64K", "  ETM 64K");
+#	endif
+	log.info("%-12s|", " CLOC 64K");
+#	ifdef WITH_LANES_TEST
+	log.info("%-12s|", "  EAX 64K");
+#	endif
+#	ifdef WITH_THREADS_TEST
+	log.info("%-12s|%-12s|%-12s|", " XEX seq 4K", " XEX rnd 4K", " XEX MT 4K");
+#	endif
+	log.info("\n");
+	log.warn("|%8lu%4s", bench_bulk(count, 1024UL),"");
+#	ifdef WITH_LARGE_TEST
+	log.warn("|%8lu%4s", bench_bulk(count, 65536UL),"");
+	log.warn("|%8lu%4s", bench_bulk(count, 16777216UL),"");
+#	endif
+	log.warn("|%8lu%4s", bench_bulkdecrypt(count, 1024UL),"");
+	log.warn("|%8lu%4s", bench_ctr(count, 1024UL),"");
+#	ifdef WITH_LANES_TEST
+	log.warn("|%8lu%4s", bench_pmac(count, 65536UL),"");
+#	endif
+#	ifdef WITH_LARGE_TEST
+	log.warn("|%8lu%4s", bench_etm(count, 65536UL, false),"");
+	log.warn("|%8lu%4s", bench_etm(count, 65536UL, true),"");
+#	endif
+	log.warn("|%8lu%4s", bench_aead<impl::Cipher8::Cloc>(count, 65536UL),"");
+#	ifdef WITH_LANES_TEST
+	log.warn("|%8lu%4s", bench_aead<impl::Cipher8::Eax>(count, 65536UL),"");
+#	endif
+#	ifdef WITH_THREADS_TEST
+	log.warn("|%8lu%4s", bench_xex(count, access::sequential),"");
+	log.warn("|%8lu%4s", bench_xex(count, access::random),"");
+	log.warn("|%8lu%4s", bench_xex(count, access::threads),"");
+#	endif
+#	ifdef WITH_THREADS_TEST
+	/* Tree MAC scaling from 1 to all cores, at most 8					*/
+	unsigned cores = crypto::mt::threads() < 8 ? crypto::mt::threads() : 8;
+	log.warn("|\n");
+	for(unsigned t = 1; t <= cores; ++t)
+		log.info("| Tree 16M %uT", t);
+	log.info("|\n");
+	for(unsigned t = 1; t <= cores; ++t)
+		log.warn("|%8lu%4s", bench_tree(count, t),"");
+#	endif
+	log.warn("|\n");
+	/* buffered word-wise formatter vs run-time alignment check			*/
+	typedef details::block_formatter<uint32_t,4,false,false> Word;
+	typedef details::block_formatter<uint32_t,4,false,true> Aligned;
+	for(unsigned offset = 0; offset < 4; ++offset)
+		log.info("| Word 1K +%u ", offset);
+	for(unsigned offset = 0; offset < 4; ++offset)
+		log.info("|Align 1K +%u ", offset);
+	log.info("|\n");
+	for(unsigned offset = 0; offset < 4; ++offset)
+		log.warn("|%8lu%4s", bench_align<Word>(count, offset),"");
+	for(unsigned offset = 0; offset < 4; ++offset)
+		log.warn("|%8lu%4s", bench_align<Aligned>(count, offset),"");
+	log.warn("|\n");
 	return true;
 }
 
@@ -365,6 +754,91 @@ unsigned test_transform(const block_t& v) {
 	return res;
 }
 
+/**
+ * test single-register vector transformation against scalar one
+ */
+unsigned test_horizontal(const block_t& v) {
+	unsigned res = 0;
+#	ifdef WITH_LANES_TEST
+	vector r(v);
+	Cipher8h h;
+	h = v;
+	r.permute();
+	h.permute();
+	if( r != h ) {
+		log.block(level::fail, "test_horizontal/permute          :", v);
+		log.block(level::error,"expected                         :", r);
+		log.block(level::error,"got                              :", h);
+		++res;
+	}
+	h.etumrep();
+	if( h != v ) {
+		log.block(level::fail, "test_horizontal/etumrep          :", v);
+		log.block(level::error,"got                              :", h);
+		++res;
+	}
+#	endif
+	return res;
+}
+
+/**
+ * test multi-state transformation kernel against scalar one, state by state
+ */
+template<class Kernel>
+unsigned test_kernel() {
+	unsigned res = 0;
+	constexpr unsigned L = Kernel::lanes;
+	for(unsigned n = 0; n + L <= 64; n += L) {
+		Kernel kernel;
+		block_t got[L];
+		kernel.load(Test::vectors + n);
+		kernel.permute();
+		kernel.store(got);
+		for(unsigned l = 0; l < L; ++l) {
+			vector r(Test::vectors[n+l]);
+			r.permute();
+			if( r != got[l] ) {
+				log.fail( "test_kernel/permute     : %u/%u\n", l, L);
+				log.block(level::error,"expected                         :", r);
+				log.block(level::error,"got                              :", got[l]);
+				++res;
+			}
+		}
+		kernel.etumrep();
+		kernel.store(got);
+		if( memcmp(got, Test::vectors + n, sizeof(got)) != 0 ) {
+			log.fail( "test_kernel/etumrep     : %u/%u\n", n, L);
+			++res;
+		}
+	}
+	return res;
+}
+
+/**
+ * test batch entry points on a count not multiple of lanes
+ */
+template<class Batch>
+unsigned test_batch() {
+	unsigned res = 0;
+	block_t blocks[63];
+	memcpy(blocks, Test::vectors, sizeof(blocks));
+	Batch::permute(blocks, 63);
+	for(unsigned i = 0; i < 63; ++i) {
+		vector r(Test::vectors[i]);
+		r.permute();
+		if( r != blocks[i] ) {
+			log.fail( "test_batch/permute      : %u\n", i);
+			++res;
+		}
+	}
+	Batch::etumrep(blocks, 63);
+	if( memcmp(blocks, Test::vectors, sizeof(blocks)) != 0 ) {
+		log.fail( "test_batch/etumrep\n");
+		++res;
+	}
+	return res;
+}
+
 /**
  * test MAC reference chaskey head-to-head with crypto::chaskey implementations
  */
@@ -443,6 +917,77 @@ unsigned test_mac(const block_t& v) {
 	return res;
 }
 
+/**
+ * test signing one message with many keys against Mac with each key
+ */
+template<class Broadcast>
+unsigned test_broadcast() {
+	unsigned res = 0;
+#	ifdef WITH_LANES_TEST
+	constexpr unsigned K = 11;
+	typename Broadcast::context keys[K];
+	block_t tags[K];
+	for(unsigned k = 0; k < K; ++k) keys[k].set(Test::vectors[k]);
+	for(auto i: {0, 15, 16, 17, 31, 32, 33, 50}) {
+		const uint8_t* msg = (const uint8_t*)(Test::plaintext+(i&3));
+		Broadcast::sign(tags, keys, K, msg, i);
+		for(unsigned k = 0; k < K; ++k) {
+			Cipher8::Mac mac(Test::vectors[k]);
+			mac.update(msg, i, true);
+			if( ! mac.verify(tags[k]) ) {
+				log.fail( "test_broadcast         : key %u, %d bytes\n", k, i);
+				log.block(level::error,"got                    :", tags[k]);
+				++res;
+			}
+		}
+	}
+#	endif
+	return res;
+}
+
+/**
+ * test batch sign and verify of messages of unequal length against Mac
+ */
+template<class Kernel>
+unsigned test_macbatch() {
+	using Mac = Cipher8::Mac;
+	constexpr unsigned K = 37;
+	unsigned res = 0;
+	Mac::context keys[K];
+	Mac::item items[K];
+	block_t tags[K];
+	uint32_t mask[(K + 31) / 32];
+	for(unsigned k = 0; k < K; ++k) {
+		keys[k].set(Test::vectors[k]);
+		items[k] = { keys + k, (const uint8_t*)(Test::plaintext + (k&3)),
+			static_cast<Mac::size_t>((k * 7) % 71), tags + k };
+	}
+	Mac::sign<Kernel>(tags, items, K);
+	for(unsigned k = 0; k < K; ++k) {
+		Mac mac(Test::vectors[k]);
+		mac.update(items[k].msg, items[k].len, true);
+		if( ! mac.verify(tags[k]) ) {
+			log.fail( "test_macbatch          : item %u, %u bytes\n", k,
+				(unsigned)items[k].len);
+			log.block(level::error,"got                    :", tags[k]);
+			++res;
+		}
+	}
+	if( ! Mac::verify<Kernel>(mask, items, K) ) {
+		log.fail( "test_macbatch          : verify failed\n");
+		++res;
+	}
+	tags[5][1] ^= 0x100;
+	tags[33][3] ^= 0x80000000;
+	if( Mac::verify<Kernel>(mask, items, K) ||
+			mask[0] != ~(UINT32_C(1) << 5) || mask[1] != 0x1D ) {
+		log.fail( "test_macbatch          : wrong mask %08X %08X\n",
+			(unsigned) mask[0], (unsigned) mask[1]);
+		++res;
+	}
+	return res;
+}
+
 const block_t iv { };
 /**
  * test CBC primitive encrypt/decrypt
@@ -468,6 +1013,868 @@ unsigned test_cbc(const block_t& v) {
 	return res;
 }
 
+/**
+ * test CBC encrypt and decrypt of long messages in chunks across runs of blocks
+ */
+unsigned test_cbcruns() {
+	unsigned res = 0;
+	impl::Cipher8::Cbc cbc(Test::vectors[2]);
+	const uint8_t* msg = (const uint8_t*)Test::vectors;
+	static uint8_t tmp[sizeof(Test::vectors)], plain[sizeof(tmp)];
+	cbc.init(iv);
+	memcpywrapper wrp{tmp, 0};
+	cbc.encrypt(wrp, msg, sizeof(tmp), true);
+	for(auto chunk: {1, 16, 17, 255, 256, 1000}) {
+		cbc.init(iv);
+		memcpywrapper out{plain, 0};
+		for(unsigned i = 0; i < sizeof(tmp); i += chunk)
+			cbc.decrypt(out, tmp + i,
+				sizeof(tmp) - i < (unsigned)chunk ? sizeof(tmp) - i : chunk);
+		if( out.size != sizeof(plain) || memcmp(msg, plain, sizeof(plain)) ) {
+			log.fail( "test_cbcruns           : chunks of %d\n", chunk);
+			++res;
+		}
+		cbc.init(iv);
+		memcpywrapper enc{plain, 0};
+		for(unsigned i = 0; i < sizeof(tmp); i += chunk)
+			cbc.encrypt(enc, msg + i, sizeof(tmp) - i < (unsigned)chunk
+				? sizeof(tmp) - i : chunk, i + chunk >= sizeof(tmp));
+		if( enc.size != sizeof(tmp) || memcmp(tmp, plain, sizeof(tmp)) ) {
+			log.fail( "test_cbcruns           : encrypt chunks of %d\n", chunk);
+			++res;
+		}
+	}
+	return res;
+}
+
+/**
+ * test fused Encrypt-then-MAC against Cbc followed by Mac of cipher text
+ */
+template<class Etm, class Cbc, class Mac>
+unsigned test_etm() {
+	unsigned res = 0;
+	const block_t& enckey(Test::vectors[4]);
+	const block_t& mackey(Test::vectors[5]);
+	const uint8_t* msg = (const uint8_t*)Test::vectors;
+	static uint8_t ref[sizeof(Test::vectors) + 16], tmp[sizeof(ref)];
+	static uint8_t plain[sizeof(ref)];
+	Etm etm(enckey, mackey);
+	Cbc cbc(enckey);
+	Mac mac(mackey);
+	for(unsigned len : {0, 1, 15, 16, 17, 64, 100, 1000, 1024}) {
+		for(unsigned chunk : {1, 16, 33, 256, 1024}) {
+			bool nonce = chunk == 33;
+			if( nonce ) {
+				cbc.init(msg, 20);
+				etm.init(msg, 20);
+			} else {
+				cbc.init(iv);
+				etm.init(iv);
+			}
+			memcpywrapper wrp{ref, 0};
+			cbc.encrypt(wrp, msg, len, true);
+			mac.init();
+			mac.update(ref, wrp.size, true);
+			memcpywrapper out{tmp, 0};
+			unsigned i = 0;
+			for(; len - i > chunk; i += chunk)
+				etm.encrypt(out, msg + i, chunk, false);
+			etm.encrypt(out, msg + i, len - i, true);
+			uint8_t tag[16];
+			mac.write(memcpywrapper{tag, 0});
+			if( out.size != wrp.size || memcmp(ref, tmp, wrp.size)
+					|| ! etm.verify(tag) ) {
+				log.fail( "test_etm               : %u in chunks of %u\n",
+					len, chunk);
+				++res;
+			}
+			if( nonce ) etm.init(msg, 20);
+			else etm.init(iv);
+			memcpywrapper dec{plain, 0};
+			for(i = 0; wrp.size - i > chunk; i += chunk)
+				etm.decrypt(dec, tmp + i, chunk, false);
+			etm.decrypt(dec, tmp + i, wrp.size - i, true);
+			if( dec.size != wrp.size || memcmp(msg, plain, len)
+					|| ! etm.verify(tag) ) {
+				log.fail( "test_etm               : decrypt %u in chunks of %u\n",
+					len, chunk);
+				++res;
+			}
+		}
+	}
+	return res;
+}
+
+/**
+ * test formatters of other targets against the default one, in Mac, Cbc
+ * and Cloc on unaligned chunks
+ */
+template<class Word>
+unsigned test_formatter(const char* name) {
+	unsigned res = 0;
+	const uint8_t* msg = (const uint8_t*)Test::vectors;
+	constexpr unsigned size = 1000;
+	static uint8_t ref[size + 16], tmp[size + 16];
+	impl::Cipher8::Mac mac(Test::vectors[6]);
+	crypto::Mac<Cipher8,Word> wmac(Test::vectors[6]);
+	impl::Cipher8::Cbc cbc(Test::vectors[7]);
+	crypto::Cbc<Cipher8,Word> wcbc(Test::vectors[7]);
+	impl::Cipher8::Cloc cloc(Test::vectors[8]);
+	crypto::Cloc<Cipher8,Word> wcloc(Test::vectors[8]);
+	for(unsigned offset = 0; offset < 4; ++offset) {
+		const uint8_t* in = msg + offset;
+		for(unsigned chunk : {1, 7, 16, 100, 1000}) {
+			memcpywrapper out{ref, 0}, wout{tmp, 0};
+			mac.init();
+			wmac.init();
+			cbc.init(iv);
+			wcbc.init(iv);
+			cloc.init();
+			wcloc.init();
+			cloc.update(in, 21, true);
+			wcloc.update(in, 21, true);
+			cloc.nonce(in, 12);
+			wcloc.nonce(in, 12);
+			unsigned i = 0;
+			for(; size - i > chunk; i += chunk) {
+				mac.update(in + i, chunk, false);
+				wmac.update(in + i, chunk, false);
+			}
+			mac.update(in + i, size - i, true);
+			wmac.update(in + i, size - i, true);
+			uint8_t tag[16];
+			mac.write(memcpywrapper{tag, 0});
+			if( ! wmac.verify(tag) ) {
+				log.fail( "test_formatter %-8s: mac %u/%u\n", name, offset, chunk);
+				++res;
+			}
+			for(i = 0; i < size; i += chunk) {
+				unsigned n = size - i < chunk ? size - i : chunk;
+				cbc.encrypt(out, in + i, n, i + n == size);
+				wcbc.encrypt(wout, in + i, n, i + n == size);
+			}
+			if( out.size != wout.size || memcmp(ref, tmp, out.size) ) {
+				log.fail( "test_formatter %-8s: cbc %u/%u\n", name, offset, chunk);
+				++res;
+			}
+			out.data = ref;
+			wout.data = tmp;
+			for(i = 0; i < size; i += chunk) {
+				unsigned n = size - i < chunk ? size - i : chunk;
+				cloc.encrypt(out, in + i, n, i + n == size);
+				wcloc.encrypt(wout, in + i, n, i + n == size);
+			}
+			cloc.write(memcpywrapper{tag, 0});
+			if( memcmp(ref, tmp, size) || ! wcloc.verify(tag) ) {
+				log.fail( "test_formatter %-8s: cloc %u/%u\n", name, offset, chunk);
+				++res;
+			}
+		}
+	}
+	return res;
+}
+
+/**
+ * test scatter-gather overloads of Mac, Cbc and Cloc against single chunks,
+ * on fragments straddling blocks, with empty ones in between and at ends
+ */
+template<typename iovec>
+unsigned test_iovec(const char* name) {
+	unsigned res = 0;
+	constexpr unsigned size = 100;
+	const uint8_t* msg = (const uint8_t*)Test::vectors + 1;
+	/* trailing zeros of a split are empty fragments too				*/
+	static const unsigned splits[][5] = {
+		{ 14, 61, 25 }, { 0, 14, 0, 86, 0 }, { 16, 0, 84 }, { 3, 5, 7, 85 },
+		{ 100 }, { 0, 0, 0, 0, 100 }, { 99, 1 }, { 48, 48, 4 }
+	};
+	uint8_t ref[size + 16], tmp[size + 16], tag[16];
+	impl::Cipher8::Mac mac(Test::vectors[6]);
+	impl::Cipher8::Cbc cbc(Test::vectors[7]);
+	impl::Cipher8::Cloc cloc(Test::vectors[8]);
+	for(auto& split : splits) {
+		iovec iov[5], civ[6];
+		unsigned count = 0, offset = 0;
+		for(auto len : split) {
+			iov[count].iov_base = (uint8_t*) msg + offset;
+			iov[count].iov_len = len;
+			civ[count].iov_base = ref + offset;
+			civ[count].iov_len = len;
+			offset += len;
+			++count;
+		}
+
+		mac.init();
+		mac.update(msg, size, true);
+		mac.write(memcpywrapper{tag, 0});
+		mac.init();
+		mac.update(iov, count, true);
+		if( ! mac.verify(tag) ) {
+			log.fail( "test_iovec %-8s     : mac %u\n", name, split[0]);
+			++res;
+		}
+
+		memcpywrapper out{ref, 0}, wout{tmp, 0};
+		cbc.init(iv);
+		cbc.encrypt(out, msg, size, true);
+		cbc.init(iv);
+		cbc.encrypt(wout, iov, count, true);
+		if( out.size != wout.size || memcmp(ref, tmp, out.size) ) {
+			log.fail( "test_iovec %-8s     : cbc encrypt %u\n", name, split[0]);
+			++res;
+		}
+		/* cipher text is gathered at the same offsets, the tail is one
+		 * more fragment													*/
+		civ[count].iov_base = ref + size;
+		civ[count].iov_len = out.size - size;
+		cbc.init(iv);
+		wout = memcpywrapper{tmp, 0};
+		cbc.decrypt(wout, civ, count + 1);
+		if( wout.size != out.size || memcmp(msg, tmp, size) ) {
+			log.fail( "test_iovec %-8s     : cbc decrypt %u\n", name, split[0]);
+			++res;
+		}
+
+		out = memcpywrapper{ref, 0};
+		wout = memcpywrapper{tmp, 0};
+		cloc.init();
+		cloc.update(msg, size, true);
+		cloc.nonce(msg, 12);
+		cloc.encrypt(out, msg, size, true);
+		cloc.write(memcpywrapper{tag, 0});
+		cloc.init();
+		cloc.update(iov, count, true);
+		cloc.nonce(msg, 12);
+		cloc.encrypt(wout, iov, count, true);
+		if( memcmp(ref, tmp, size) || ! cloc.verify(tag) ) {
+			log.fail( "test_iovec %-8s     : cloc encrypt %u\n", name, split[0]);
+			++res;
+		}
+		wout = memcpywrapper{tmp, 0};
+		cloc.init();
+		cloc.update(iov, count, true);
+		cloc.nonce(msg, 12);
+		cloc.decrypt(wout, civ, count, true);
+		if( memcmp(msg, tmp, size) || ! cloc.verify(tag) ) {
+			log.fail( "test_iovec %-8s     : cloc decrypt %u\n", name, split[0]);
+			++res;
+		}
+	}
+	return res;
+}
+
+/**
+ * test direct-to-buffer overloads of Cbc and Cloc against the stream ones,
+ * to a separate buffer and in place, in chunks
+ */
+unsigned test_inplace() {
+	unsigned res = 0;
+	constexpr unsigned size = 1000;
+	const uint8_t* msg = (const uint8_t*)Test::vectors + 1;
+	static uint8_t ref[size + 16], tmp[size + 16], buf[size + 16];
+	uint8_t tag[16];
+	impl::Cipher8::Cbc cbc(Test::vectors[7]);
+	impl::Cipher8::Cloc cloc(Test::vectors[8]);
+	for(unsigned chunk : {1, 7, 16, 100, 1000}) {
+		for(bool inplace : {false, true}) {
+			memcpywrapper out{ref, 0};
+			cbc.init(iv);
+			cbc.encrypt(out, msg, size, true);
+			/* in place, output lags input by the bytes being buffered	*/
+			uint8_t* dst = inplace ? buf : tmp;
+			memcpy(buf, msg, size);
+			unsigned n = 0;
+			cbc.init(iv);
+			for(unsigned i = 0; i < size; i += chunk)
+				n += cbc.encrypt(dst + n, buf + i, size - i < chunk
+					? size - i : chunk, i + chunk >= size);
+			if( n != out.size || memcmp(ref, dst, n) ) {
+				log.fail( "test_inplace           : cbc encrypt %u/%d\n",
+					chunk, inplace);
+				++res;
+			}
+			memcpy(buf, ref, out.size);
+			n = 0;
+			cbc.init(iv);
+			for(unsigned i = 0; i < out.size; i += chunk)
+				n += cbc.decrypt(dst + n, buf + i, out.size - i < chunk
+					? out.size - i : chunk);
+			if( n != out.size || memcmp(msg, dst, size) ) {
+				log.fail( "test_inplace           : cbc decrypt %u/%d\n",
+					chunk, inplace);
+				++res;
+			}
+
+			out = memcpywrapper{ref, 0};
+			cloc.init();
+			cloc.nonce(msg, 12);
+			cloc.encrypt(out, msg, size, true);
+			cloc.write(memcpywrapper{tag, 0});
+			memcpy(buf, msg, size);
+			n = 0;
+			cloc.init();
+			cloc.nonce(msg, 12);
+			for(unsigned i = 0; i < size; i += chunk)
+				n += cloc.encrypt(dst + n, buf + i, size - i < chunk
+					? size - i : chunk, i + chunk >= size);
+			if( n != size || memcmp(ref, dst, size) || ! cloc.verify(tag) ) {
+				log.fail( "test_inplace           : cloc encrypt %u/%d\n",
+					chunk, inplace);
+				++res;
+			}
+			memcpy(buf, ref, size);
+			n = 0;
+			cloc.init();
+			cloc.nonce(msg, 12);
+			for(unsigned i = 0; i < size; i += chunk)
+				n += cloc.decrypt(dst + n, buf + i, size - i < chunk
+					? size - i : chunk, i + chunk >= size);
+			if( n != size || memcmp(msg, dst, size) || ! cloc.verify(tag) ) {
+				log.fail( "test_inplace           : cloc decrypt %u/%d\n",
+					chunk, inplace);
+				++res;
+			}
+		}
+	}
+	return res;
+}
+
+#ifdef WITH_LARGE_TEST
+/**
+ * test messages larger 64K in Mac, Cbc and Cloc, in one call and in one
+ * iovec fragment, against chunks of 1000 bytes
+ */
+unsigned test_largelen() {
+	unsigned res = 0;
+	constexpr unsigned long size = 200003;
+	static uint8_t msg[size], ref[size + 16], tmp[size + 16];
+	uint8_t tag[16];
+	for(unsigned long i = 0; i < size; ++i) msg[i] = i * 131 + (i >> 8);
+	const crypto::iovec iov[] = { { msg, size } };
+	/* one call is possible only if lengths are not narrowed			*/
+	const bool single = size <= impl::Cipher8::Mac::size_t(-1);
+	impl::Cipher8::Mac mac(Test::vectors[6]);
+	impl::Cipher8::Cbc cbc(Test::vectors[7]);
+	impl::Cipher8::Cloc cloc(Test::vectors[8]);
+
+	mac.init();
+	for(unsigned long i = 0; i < size; i += 1000)
+		mac.update(msg + i, size - i < 1000 ? size - i : 1000, i + 1000 >= size);
+	mac.write(memcpywrapper{tag, 0});
+	if( single ) {
+		mac.init();
+		mac.update(msg, size, true);
+		if( ! mac.verify(tag) ) {
+			log.fail( "test_largelen          : mac\n");
+			++res;
+		}
+	}
+	mac.init();
+	mac.update(iov, 1, true);
+	if( ! mac.verify(tag) ) {
+		log.fail( "test_largelen          : mac iovec\n");
+		++res;
+	}
+
+	memcpywrapper out{ref, 0};
+	cbc.init(iv);
+	for(unsigned long i = 0; i < size; i += 1000)
+		cbc.encrypt(out, msg + i, size - i < 1000 ? size - i : 1000,
+			i + 1000 >= size);
+	if( single ) {
+		memcpywrapper wout{tmp, 0};
+		cbc.init(iv);
+		cbc.encrypt(wout, msg, size, true);
+		if( wout.size != out.size || memcmp(ref, tmp, out.size) ) {
+			log.fail( "test_largelen          : cbc\n");
+			++res;
+		}
+	}
+	memcpywrapper wout{tmp, 0};
+	cbc.init(iv);
+	cbc.encrypt(wout, iov, 1, true);
+	if( wout.size != out.size || memcmp(ref, tmp, out.size) ) {
+		log.fail( "test_largelen          : cbc iovec\n");
+		++res;
+	}
+	const crypto::iovec civ[] = { { ref, out.size } };
+	wout = memcpywrapper{tmp, 0};
+	cbc.init(iv);
+	cbc.decrypt(wout, civ, 1);
+	if( wout.size != out.size || memcmp(msg, tmp, size) ) {
+		log.fail( "test_largelen          : cbc decrypt iovec\n");
+		++res;
+	}
+
+	out = memcpywrapper{ref, 0};
+	cloc.init();
+	cloc.nonce(msg, 12);
+	for(unsigned long i = 0; i < size; i += 1000)
+		cloc.encrypt(out, msg + i, size - i < 1000 ? size - i : 1000,
+			i + 1000 >= size);
+	cloc.write(memcpywrapper{tag, 0});
+	if( single ) {
+		wout = memcpywrapper{tmp, 0};
+		cloc.init();
+		cloc.nonce(msg, 12);
+		cloc.encrypt(wout, msg, size, true);
+		if( memcmp(ref, tmp, size) || ! cloc.verify(tag) ) {
+			log.fail( "test_largelen          : cloc\n");
+			++res;
+		}
+	}
+	wout = memcpywrapper{tmp, 0};
+	cloc.init();
+	cloc.nonce(msg, 12);
+	cloc.encrypt(wout, iov, 1, true);
+	if( memcmp(ref, tmp, size) || ! cloc.verify(tag) ) {
+		log.fail( "test_largelen          : cloc iovec\n");
+		++res;
+	}
+	return res;
+}
+#endif
+
+/**
+ * test CTR key stream against the cipher, chunked, in place and seek
+ */
+unsigned test_ctr() {
+	unsigned res = 0;
+	const block_t& key(Test::vectors[3]);
+	const block_t ctriv { 0xFFFFFFFE, 0xFFFFFFFF, 0x12345678, 0 };
+	impl::Cipher8::Ctr ctr(key);
+	uint8_t zero[sizeof(Test::vectors)] {};
+	uint8_t tmp[sizeof(Test::vectors)];
+	uint8_t plain[sizeof(Test::vectors)];
+	const uint8_t* msg = (const uint8_t*)Test::vectors;
+	/* key stream is the cipher of the counter block */
+	ctr.init(ctriv);
+	ctr.encrypt(zero, sizeof(zero));
+	for(unsigned i = 0; i < sizeof(zero) / sizeof(block_t); ++i) {
+		block_t c { ctriv[0] + i, ctriv[1], ctriv[2], ctriv[3] };
+		if( c[0] < i ) ++c[1];
+		if( c[1] == 0 && c[0] < i ) ++c[2];
+		Cipher8 cipher;
+		cipher = c;
+		cipher ^= key;
+		cipher.permute();
+		cipher ^= key;
+		block_t ref;
+		memcpy(ref, cipher.raw(), sizeof(ref));
+		details::block_formatter<uint32_t,4>::final(ref);
+		if( memcmp(ref, zero + i * sizeof(block_t), sizeof(ref)) ) {
+			log.fail( "test_ctr               : key stream block %u\n", i);
+			++res;
+		}
+	}
+	/* chunked through stream, then decrypted in place */
+	ctr.init(iv);
+	memcpywrapper out{tmp, 0};
+	for(unsigned i = 0, chunk = 1; i < sizeof(tmp); i += chunk, chunk += 37)
+		ctr.encrypt(out, msg + i,
+			sizeof(tmp) - i < chunk ? sizeof(tmp) - i : chunk);
+	memcpy(plain, tmp, sizeof(plain));
+	ctr.init(iv);
+	ctr.decrypt(plain, sizeof(plain));
+	if( out.size != sizeof(tmp) || memcmp(msg, plain, sizeof(plain)) ) {
+		log.fail( "test_ctr               : chunked\n");
+		++res;
+	}
+	/* random access */
+	for(unsigned offset: {1000, 0, 17, 255, 256, 257, 511, 3}) {
+		uint8_t part[13];
+		unsigned len = sizeof(tmp) - offset < sizeof(part)
+			? sizeof(tmp) - offset : sizeof(part);
+		memcpy(part, tmp + offset, len);
+		ctr.seek(offset);
+		ctr.decrypt(part, len);
+		if( memcmp(part, msg + offset, len) || ctr.tell() != offset + len ) {
+			log.fail( "test_ctr               : seek to %u\n", offset);
+			++res;
+		}
+	}
+	return res;
+}
+
+#ifdef WITH_LANES_TEST
+/**
+ * reference PMAC, one block at a time with Cipher8
+ */
+static void pmac_reference(block_t& tag, const block_t& key,
+		const uint8_t* msg, unsigned len) {
+	Cipher8 e;
+	block_t lstar, l[16], delta = {}, sum = {};
+	auto encrypt = [&e, &key](block_t& x) {
+		e = x;
+		e ^= key;
+		e.permute();
+		e ^= key;
+		memcpy(x, e.raw(), sizeof(x));
+	};
+	memset(lstar, 0, sizeof(lstar));
+	encrypt(lstar);
+	Cipher8::derive(l[0], lstar);			/* L_$ */
+	Cipher8::derive(l[0], l[0]);
+	for(unsigned i = 1; i < 16; ++i) Cipher8::derive(l[i], l[i-1]);
+	unsigned i = 1;
+	for(; len > sizeof(block_t); ++i, len -= sizeof(block_t)) {
+		block_t x;
+		memcpy(x, msg, sizeof(x));
+		for(unsigned j = 4; j--; ) x[j] ^= (delta[j] ^= l[__builtin_ctz(i)][j]);
+		encrypt(x);
+		for(unsigned j = 4; j--; ) sum[j] ^= x[j];
+		msg += sizeof(block_t);
+	}
+	uint8_t last[sizeof(block_t)] = {};
+	memcpy(last, msg, len);
+	block_t ldollar;
+	Cipher8::derive(ldollar, lstar);
+	if( len < sizeof(last) ) last[len] = 1;
+	for(unsigned j = 4; j--; ) {
+		uint32_t w;
+		memcpy(&w, last + j * 4, 4);
+		sum[j] ^= w ^ (len == sizeof(last) ? ldollar[j] : 0);
+	}
+	encrypt(sum);
+	memcpy(tag, sum, sizeof(tag));
+}
+
+/**
+ * test PMAC against the reference, chunked and in segments
+ */
+unsigned test_pmac() {
+	unsigned res = 0;
+	typedef impl::Cipher8::Pmac Pmac;
+	const block_t& key(Test::vectors[5]);
+	const uint8_t* msg = (const uint8_t*)Test::vectors;
+	Pmac pmac(key);
+	Pmac::context ctx;
+	ctx.set(key);
+	/* offsets past 2^32 blocks: gray(2^32) = 2^32 ^ 2^31, L_32 = 2·L_31	*/
+	for(uint64_t i : {UINT64_C(1) << 32, (UINT64_C(1) << 32) + 1}) {
+		block_t l32, expected, delta;
+		Cipher8::derive(l32, ctx.l[31]);
+		for(unsigned j = 4; j--; ) expected[j] = ctx.l[31][j] ^ l32[j];
+		if( i & 1 )
+			for(unsigned j = 4; j--; ) expected[j] ^= ctx.l[0][j];
+		ctx.offset(delta, i);
+		block_t next;
+		ctx.offset(next, i - 1);
+		ctx.next(next, i);
+		if( memcmp(expected, delta, sizeof(delta))
+				|| memcmp(expected, next, sizeof(next)) ) {
+			log.fail( "test_pmac              : offset of block 2^32+%u\n",
+				(unsigned)(i & 1));
+			++res;
+		}
+	}
+	for(unsigned len : {0, 1, 15, 16, 17, 32, 33, 255, 256, 1000, 1024}) {
+		block_t ref, tag;
+		pmac_reference(ref, key, msg, len);
+		Pmac::sign(tag, ctx, msg, len);
+		if( memcmp(ref, tag, sizeof(tag)) ) {
+			log.fail( "test_pmac              : sign %u\n", len);
+			++res;
+		}
+		for(unsigned chunk : {1, 16, 17, 100}) {
+			pmac.init();
+			unsigned i = 0;
+			for(; len - i > chunk; i += chunk)
+				pmac.update(msg + i, chunk, false);
+			pmac.update(msg + i, len - i, true);
+			if( ! pmac.verify(ref) ) {
+				log.fail( "test_pmac              : %u in chunks of %u\n",
+					len, chunk);
+				++res;
+			}
+		}
+		/* two segments, as if absorbed on separate threads				*/
+		unsigned blocks = len ? (len - 1) / sizeof(block_t) : 0;
+		block_t sum1 = {}, sum2 = {};
+		Pmac::absorb(sum1, ctx, 1, msg, blocks / 3);
+		Pmac::absorb(sum2, ctx, blocks / 3 + 1,
+			msg + blocks / 3 * sizeof(block_t), blocks - blocks / 3);
+		for(unsigned j = 4; j--; ) sum1[j] ^= sum2[j];
+		Pmac::finish(tag, ctx, sum1, msg + blocks * sizeof(block_t),
+			len - blocks * sizeof(block_t));
+		if( memcmp(ref, tag, sizeof(tag)) ) {
+			log.fail( "test_pmac              : segments %u\n", len);
+			++res;
+		}
+	}
+	return res;
+}
+
+/**
+ * test EAX against composition of Pmac and Ctr, chunked and tampered
+ */
+unsigned test_eax() {
+	unsigned res = 0;
+	typedef impl::Cipher8::Pmac Pmac;
+	const block_t& key(Test::vectors[6]);
+	const uint8_t* msg = (const uint8_t*)Test::vectors;
+	static uint8_t buf[sizeof(block_t) + sizeof(Test::vectors)];
+	static uint8_t ref[sizeof(Test::vectors)], tmp[sizeof(Test::vectors)];
+	Pmac::context ctx;
+	ctx.set(key);
+	impl::Cipher8::Eax eax(key);
+	for(unsigned len : {0, 1, 16, 31, 300, 1024}) {
+		unsigned adlen = len % 37, noncelen = 5 + len % 12;
+		const uint8_t* ad = msg + 7;
+		const uint8_t* nonce = msg + 100;
+		block_t n, h, c;
+		auto prf = [&ctx](block_t& tag, uint8_t t, const uint8_t* m, unsigned l) {
+			memset(buf, 0, sizeof(block_t));
+			buf[sizeof(block_t) - 1] = t;
+			memcpy(buf + sizeof(block_t), m, l);
+			Pmac::sign(tag, ctx, buf, sizeof(block_t) + l);
+		};
+		prf(n, 0, nonce, noncelen);
+		prf(h, 1, ad, adlen);
+		impl::Cipher8::Ctr ctr(key);
+		ctr.init(n);
+		memcpy(ref, msg, len);
+		ctr.encrypt(ref, len);
+		prf(c, 2, ref, len);
+		for(unsigned j = 4; j--; ) c[j] ^= n[j] ^ h[j];
+
+		for(unsigned chunk : {1, 16, 100, 1024}) {
+			eax.init();
+			eax.update(ad, adlen, true);
+			eax.nonce(nonce, noncelen);
+			memcpywrapper out{tmp, 0};
+			unsigned i = 0;
+			for(; len - i > chunk; i += chunk)
+				eax.encrypt(out, msg + i, chunk, false);
+			eax.encrypt(out, msg + i, len - i, true);
+			if( out.size != len || memcmp(ref, tmp, len) || ! eax.verify(c) ) {
+				log.fail( "test_eax               : encrypt %u in chunks of %u\n",
+					len, chunk);
+				++res;
+			}
+		}
+		eax.init();
+		eax.update(ad, adlen, true);
+		eax.nonce(nonce, noncelen);
+		memcpywrapper out{tmp, 0};
+		eax.decrypt(out, ref, len, true);
+		if( out.size != len || memcmp(msg, tmp, len) || ! eax.verify(c) ) {
+			log.fail( "test_eax               : decrypt %u\n", len);
+			++res;
+		}
+		ref[len / 2] ^= 1;
+		eax.init();
+		eax.update(ad, adlen, true);
+		eax.nonce(nonce, noncelen);
+		eax.decrypt(memcpywrapper{tmp, 0}, ref, len, true);
+		if( len && eax.verify(c) ) {
+			log.fail( "test_eax               : tampered %u verified\n", len);
+			++res;
+		}
+	}
+	return res;
+}
+
+/**
+ * test Tree MAC against composition of Pmac, chunked and on threads
+ */
+unsigned test_tree() {
+	unsigned res = 0;
+	typedef impl::Cipher8::Pmac Pmac;
+	typedef impl::Cipher8::Tree Tree;
+	const block_t& key(Test::vectors[8]);
+	const uint8_t* msg = (const uint8_t*)Test::vectors;
+	block_t kl, kn;
+	Cipher8::derive(kl, key);
+	Cipher8::derive(kl, kl);
+	Cipher8::derive(kl, kl);
+	Cipher8::derive(kn, kl);
+	Cipher8::derive(kn, kn);
+	Cipher8::derive(kn, kn);
+	Pmac::context leafctx;
+	leafctx.set(kl);
+	Tree tree;
+#	ifdef WITH_THREADS_TEST
+	crypto::mt::pool one(1), two(2), three(3);
+	crypto::mt::pool* pools[] = { &one, &two, &three };
+#	endif
+	/* leaf size is rounded down to whole blocks, at least one			*/
+	for(unsigned leaf : {0, 1, 15, 100}) {
+		tree.set(key, leaf);
+		if( tree.leaf() != (leaf < 16 ? 16 : leaf / 16 * 16) ) {
+			log.fail( "test_tree              : leaf size %u is %u\n", leaf,
+				(unsigned) tree.leaf());
+			++res;
+		}
+	}
+	for(unsigned leaf : {16, 64, 1024}) {
+		tree.set(key, leaf);
+		for(unsigned len : {0, 1, 64, 65, 1000, 1024}) {
+			Pmac node(kn);
+			unsigned i = 0;
+			do {
+				block_t tag;
+				unsigned n = len - i < leaf ? len - i : leaf;
+				Pmac::sign(tag, leafctx, msg + i, n);
+				node.update((const uint8_t*)tag, sizeof(tag), false);
+				i += n;
+			} while( i < len );
+			const block_t last = { len, 0, leaf, 0 };
+			node.update((const uint8_t*)last, sizeof(last), true);
+
+			for(unsigned chunk : {1, 100, 4096}) {
+				tree.init();
+				for(i = 0; len - i > chunk; i += chunk)
+					tree.update(msg + i, chunk, false);
+				tree.update(msg + i, len - i, true);
+				if( ! tree.verify(node.tag()) ) {
+					log.fail( "test_tree              : %u/%u in chunks of %u\n",
+						len, leaf, chunk);
+					++res;
+				}
+			}
+#			ifdef WITH_THREADS_TEST
+			for(auto pool : pools) {
+				crypto::mt::sign(tree, *pool, msg, len);
+				if( ! tree.verify(node.tag()) ) {
+					log.fail( "test_tree              : %u/%u on %u threads\n",
+						len, leaf, pool->size());
+					++res;
+				}
+			}
+#			endif
+		}
+	}
+	return res;
+}
+#endif
+
+/**
+ * test XEX sectors against the definition, single sector access and threads
+ */
+unsigned test_xex() {
+	unsigned res = 0;
+	typedef impl::Cipher8::Xex Xex;
+	const block_t& key(Test::vectors[7]);
+	static uint8_t image[sizeof(Test::vectors)];
+	const uint8_t* plain = (const uint8_t*)Test::vectors;
+	Xex xex(key);
+	for(unsigned size : {512, 64, 16}) {
+		const Xex::sector_t first = 0xFFFFFFF0ULL;
+		const unsigned count = sizeof(image) / size;
+		memcpy(image, plain, sizeof(image));
+		xex.encrypt(first, image, count, size);
+		for(unsigned s = 0; s < count; ++s) {
+			Cipher8 e;
+			block_t l = { uint32_t(first + s), uint32_t((first + s) >> 32) };
+			e = l;
+			e ^= key;
+			e.permute();
+			e ^= key;
+			block_t delta;
+			Cipher8::derive(delta, e);
+			for(unsigned b = 0; b < size / sizeof(block_t); ++b) {
+				block_t x;
+				memcpy(x, plain + s * size + b * sizeof(block_t), sizeof(x));
+				for(unsigned j = 4; j--; ) x[j] ^= delta[j] ^ key[j];
+				e = x;
+				e.permute();
+				e ^= key;
+				e ^= delta;
+				if( memcmp(e.raw(), image + s * size + b * sizeof(x), sizeof(x)) ) {
+					log.fail( "test_xex               : sector %u block %u of %u\n",
+						s, b, size);
+					++res;
+				}
+				Cipher8::derive(delta, delta);
+			}
+		}
+		/* any sector decrypts alone										*/
+		xex.decrypt(first + count / 2, image + count / 2 * size, size);
+		if( memcmp(image + count / 2 * size, plain + count / 2 * size, size) ) {
+			log.fail( "test_xex               : single sector of %u\n", size);
+			++res;
+		}
+		xex.decrypt(first, image, count / 2, size);
+		xex.decrypt(first + count / 2 + 1, image + (count / 2 + 1) * size,
+			count - count / 2 - 1, size);
+		if( memcmp(image, plain, sizeof(image)) ) {
+			log.fail( "test_xex               : decrypt %u\n", size);
+			++res;
+		}
+#		ifdef WITH_THREADS_TEST
+		static uint8_t copy[sizeof(image)];
+		xex.encrypt(first, image, count, size);
+		memcpy(copy, plain, sizeof(copy));
+		crypto::mt::encrypt(xex, first, copy, count, size, 3);
+		if( memcmp(image, copy, sizeof(copy)) ) {
+			log.fail( "test_xex               : threads %u\n", size);
+			++res;
+		}
+		crypto::mt::decrypt(xex, first, copy, count, size, 5);
+		if( memcmp(copy, plain, sizeof(copy)) ) {
+			log.fail( "test_xex               : threads decrypt %u\n", size);
+			++res;
+		}
+		/* zero threads run on the calling one							*/
+		crypto::mt::encrypt(xex, first, copy, count, size, 0);
+		if( memcmp(image, copy, sizeof(copy)) ) {
+			log.fail( "test_xex               : zero threads %u\n", size);
+			++res;
+		}
+		crypto::mt::decrypt(xex, first, copy, count, size, 0);
+		if( memcmp(copy, plain, sizeof(copy)) ) {
+			log.fail( "test_xex               : zero threads decrypt %u\n", size);
+			++res;
+		}
+#		endif
+	}
+	/* ciphertext stealing: with m full blocks and a tail of r bytes,
+	 * CC = XEX_(m-1)(M[m-1]), C[m] = CC[0..r), C[m-1] = XEX_m(M[m]||CC[r..]),
+	 * XEX_j is checked as block j of sectors of whole blocks			*/
+	for(unsigned size : {17, 31, 100, 1000}) {
+		const Xex::sector_t sector = 7;
+		const unsigned m = size / sizeof(block_t), r = size % sizeof(block_t);
+		static uint8_t whole[sizeof(image)];
+		memcpy(image, plain, size);
+		if( ! xex.encrypt(sector, image, size) ) {
+			log.fail( "test_xex               : rejected %u\n", size);
+			++res;
+		}
+		memcpy(whole, plain, m * sizeof(block_t));
+		xex.encrypt(sector, whole, m * sizeof(block_t));
+		uint8_t cc[sizeof(block_t)];
+		memcpy(cc, whole + (m - 1) * sizeof(block_t), sizeof(cc));
+		memcpy(whole + m * sizeof(block_t), plain + m * sizeof(block_t), r);
+		memcpy(whole + m * sizeof(block_t) + r, cc + r, sizeof(cc) - r);
+		static uint8_t last[sizeof(image)];
+		memcpy(last, plain, (m - 1) * sizeof(block_t));
+		memcpy(last + m * sizeof(block_t), whole + m * sizeof(block_t),
+			sizeof(block_t));
+		xex.encrypt(sector, last, (m + 1) * sizeof(block_t));
+		if( memcmp(image, whole, (m - 1) * sizeof(block_t))
+				|| memcmp(image + (m - 1) * sizeof(block_t),
+					last + m * sizeof(block_t), sizeof(block_t))
+				|| memcmp(image + m * sizeof(block_t), cc, r) ) {
+			log.fail( "test_xex               : stealing %u\n", size);
+			++res;
+		}
+		xex.decrypt(sector, image, size);
+		if( memcmp(image, plain, size) ) {
+			log.fail( "test_xex               : stealing decrypt %u\n", size);
+			++res;
+		}
+	}
+	/* sectors shorter than a block are rejected, data is left unchanged	*/
+	memcpy(image, plain, 15);
+	if( xex.encrypt(0, image, 15) || xex.decrypt(0, image, 1, 5)
+			|| memcmp(image, plain, 15) || ! xex.encrypt(0, image, 0) ) {
+		log.fail( "test_xex               : short sectors\n");
+		++res;
+	}
+	return res;
+}
+
 const block_t& get_test_vector(unsigned i) {
 	if(i > 63) i = 0;
 	return Test::vectors[i];
@@ -589,6 +1996,73 @@ unsigned test_cloc(const block_t& v) {
 	return res;
 }
 
+/**
+ * test batch seal and open of packets of unequal length against Cloc
+ */
+template<class Kernel>
+unsigned test_clocbatch() {
+	using Cloc = impl::Cipher8::Cloc;
+	constexpr unsigned K = 23;
+	unsigned res = 0;
+	Cloc::packet packets[K];
+	uint8_t sealed[K][80], opened[K][80], tags[K][16];
+	uint32_t mask[1];
+	/* byte masks of partial blocks take the bytes, that xor_bytes does	*/
+	for(uint_fast8_t len = 0; len <= sizeof(block_t); ++len) {
+		block_t ones, bytes = {}, word = {}, expected = {}, result = {};
+		__builtin_memset(ones, 0xFF, sizeof(ones));
+		details::block_formatter<uint32_t,4>::mask(bytes, len);
+		details::block_formatter<uint32_t,4>::xor_bytes(
+			reinterpret_cast<uint8_t*>(expected), ones, len);
+		details::block_formatter<uint32_t,4,false,false>::mask(word, len);
+		details::block_formatter<uint32_t,4,false,false>::xor_bytes(
+			reinterpret_cast<uint8_t*>(result), ones, len);
+		if( memcmp(bytes, expected, sizeof(block_t))
+				|| memcmp(word, result, sizeof(block_t)) ) {
+			log.fail( "test_clocbatch         : byte mask of %u\n",
+				(unsigned) len);
+			++res;
+		}
+	}
+	for(unsigned k = 0; k < K; ++k) {
+		packets[k] = { Test::vectors + k,
+			(const uint8_t*)(Test::plaintext + (k&3)),
+			static_cast<Cloc::size_t>((k * 7) % 40),
+			(const uint8_t*)nonce, static_cast<Cloc::size_t>(k % 17),
+			(const uint8_t*)(Test::plaintext + (k%6)), sealed[k],
+			static_cast<Cloc::size_t>((k * 11) % 70), tags[k] };
+	}
+	Cloc::seal<Kernel>(packets, K);
+	for(unsigned k = 0; k < K; ++k) {
+		const Cloc::packet& p = packets[k];
+		uint8_t tmp[80];
+		Cloc cloc(Test::vectors[k]);
+		cloc.update(p.ad, p.adlen, true);
+		cloc.nonce(p.nonce, p.noncelen);
+		cloc.encrypt(memcpywrapper{tmp,0}, p.in, p.len, true);
+		if( memcmp(tmp, sealed[k], p.len) || ! cloc.verify(tags[k]) ) {
+			log.fail( "test_clocbatch         : seal packet %u\n", k);
+			++res;
+		}
+		packets[k].in = sealed[k];
+		packets[k].out = opened[k];
+	}
+	tags[3][7] ^= 1;
+	if( Cloc::open<Kernel>(mask, packets, K) ||
+			mask[0] != ((UINT32_C(1) << K) - 1 - (1 << 3)) ) {
+		log.fail( "test_clocbatch         : wrong mask %08X\n",
+			(unsigned) mask[0]);
+		++res;
+	}
+	for(unsigned k = 0; k < K; ++k) {
+		if( memcmp(opened[k], Test::plaintext + (k%6), packets[k].len) ) {
+			log.fail( "test_clocbatch         : open packet %u\n", k);
+			++res;
+		}
+	}
+	return res;
+}
+
 /**
  * test CBC primitive encrypt/decrypt
  */
@@ -627,6 +2101,50 @@ unsigned test_clocchunk() {
 	return 0;
 }
 
+#ifdef WITH_LANES_TEST
+/**
+ * test CLOC runs of full blocks against the batch, in chunks and decrypted
+ */
+unsigned test_clocruns() {
+	using Cloc = impl::Cipher8::Cloc;
+	unsigned res = 0;
+	const uint8_t* msg = (const uint8_t*)Test::vectors;
+	constexpr unsigned size = 1000;
+	static uint8_t sealed[size], tmp[size], plain[size];
+	uint8_t tag[16];
+	Cloc::packet packet = { Test::vectors + 9, msg + 3, 21,
+		(const uint8_t*)nonce, 11, msg, sealed, size, tag };
+	Cloc::seal<Cipher8::Kernel>(&packet, 1);
+	Cloc cloc(Test::vectors[9]);
+	for(unsigned chunk : {1, 16, 37, 64, 1000}) {
+		cloc.init();
+		cloc.update(msg + 3, 21, true);
+		cloc.nonce((const uint8_t*)nonce, 11);
+		memcpywrapper out{tmp, 0};
+		unsigned i = 0;
+		for(; size - i > chunk; i += chunk)
+			cloc.encrypt(out, msg + i, chunk, false);
+		cloc.encrypt(out, msg + i, size - i, true);
+		if( memcmp(tmp, sealed, size) || ! cloc.verify(tag) ) {
+			log.fail( "test_clocruns          : seal in chunks of %u\n", chunk);
+			++res;
+		}
+		cloc.init();
+		cloc.update(msg + 3, 21, true);
+		cloc.nonce((const uint8_t*)nonce, 11);
+		memcpywrapper dec{plain, 0};
+		for(i = 0; size - i > chunk; i += chunk)
+			cloc.decrypt(dec, sealed + i, chunk, false);
+		cloc.decrypt(dec, sealed + i, size - i, true);
+		if( memcmp(plain, msg, size) || ! cloc.verify(tag) ) {
+			log.fail( "test_clocruns          : open in chunks of %u\n", chunk);
+			++res;
+		}
+	}
+	return res;
+}
+#endif
+
 bool test_debug() {
 	return true;
 }
@@ -636,23 +2154,77 @@ bool test() {
 	if( ! test_debug() ) return false;
 	log.info("Running self-test %s\n", (chaskey_cpp == &::chaskey ?
 			"without head-2-head" : "with head-2-head"));
+	log.info("Batch kernel %s\n", Cipher8s::Batch::kernel());
 	unsigned res = ! test_vectors();
 	for(const block_t& v : Test::vectors) {
 		log.info(".");
 		res += test_rolror(v);
 		res += test_transform(v);
+		res += test_horizontal(v);
 		res += test_cbc(v);
 		res += test_cloc(v);
 	}
 	log.info(".");
+#	ifdef WITH_LANES_TEST
+	res += test_kernel<Cipher<8>::Lanes<4>>();
+	res += test_kernel<Cipher<8>::Lanes<8>>();
+	res += test_kernel<Cipher<8>::Lanes<16>>();
+	res += test_kernel<Swar<8>>();
+	res += test_batch<details::batch<Swar<8>>>();
+#	endif
+	res += test_kernel<Interleaved<8,2>>();
+	res += test_kernel<Interleaved<8,3>>();
+	res += test_kernel<Interleaved<8,4>>();
+	res += test_kernel<Sequential<8,2>>();
+	res += test_batch<Cipher<8>::Batch>();
+	res += test_batch<Cipher8s::Batch>();
+	res += test_batch<details::batch<Interleaved<8,3>>>();
+	log.info(".");
 	if( chaskey_cpp != &::chaskey )
 		res += test_head2head(Test::vectors[0]);
 	log.info(".");
 	res += test_mac(Test::vectors[0]);
+	res += test_broadcast<Cipher8::Broadcast>();
+	res += test_macbatch<Cipher8::Kernel>();
+	res += test_macbatch<Interleaved<8,3>>();
+#	ifdef WITH_LANES_TEST
+	res += test_macbatch<Swar<8>>();
+#	endif
+	res += test_broadcast<Broadcast<Cipher8, Interleaved<8,3>,
+		details::block_formatter<uint32_t,4>>>();
+	res += test_broadcast<Broadcast<Cipher8, Swar<8>,
+		details::block_formatter<uint32_t,4>>>();
 	log.info(".");
 	res += test_clocchunk();
+#	ifdef WITH_LANES_TEST
+	res += test_clocbatch<Cipher8::Lanes<>>();
+	res += test_clocbatch<Swar<8>>();
+#	endif
 	log.info(".");
 	res += test_master();
+	res += test_cbcruns();
+	res += test_formatter<details::block_formatter<uint32_t,4,false,false>>(
+		"word");
+	res += test_formatter<details::block_formatter<uint32_t,4,false,true>>(
+		"aligned");
+	res += test_iovec<crypto::iovec>("crypto");
+#	ifdef WITH_UIO_TEST
+	res += test_iovec<::iovec>("posix");
+#	endif
+	res += test_inplace();
+#	ifdef WITH_LARGE_TEST
+	res += test_largelen();
+#	endif
+	res += test_etm<impl::Cipher8::Etm, impl::Cipher8::Cbc, impl::Cipher8::Mac>();
+	res += test_etm<Cipher8s::Etm, Cipher8s::Cbc, Cipher8s::Mac>();
+	res += test_ctr();
+	res += test_xex();
+#	ifdef WITH_LANES_TEST
+	res += test_clocruns();
+	res += test_pmac();
+	res += test_eax();
+	res += test_tree();
+#	endif
 	if( res )
 		log.warn("\n%d tests failed\n", res);
 	else